@@ -8,11 +8,19 @@
 #include <physiology/modules/messages/status.h>
 #include <glog/logging.h>
 #include <opencv2/opencv.hpp>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <chrono>
 #include <iomanip>
+#include <random>
 #include <sstream>
 #include <ctime>
 #include <filesystem>
@@ -20,7 +28,16 @@
 // MJPEG Streamer
 #include <nadjieb/mjpeg_streamer.hpp>
 
+#include <vitals/raw_vitals_format.hpp>
+#include <vitals/stress_detection.hpp>
+
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace presage::smartspectra;
 
@@ -31,41 +48,238 @@ struct QuestionSummary {
     double avg_breathing;
     double duration;
     size_t sample_count;
+    vitals::BaselineSummary pulse_baseline;
+    vitals::BaselineSummary breathing_baseline;
 };
 
-// Helper struct for Stress Events
-struct StressEvent {
-    int question_number;
-    double time_offset_sec; // Seconds from start of question
-    std::string type;       // "Pulse" or "Breathing"
-    float value;
+// Writes the raw sample log on a background thread so the metrics callback never waits on
+// the disk. Append copies the record into a single-producer ring and returns; the writer
+// takes whole batches, formatting them with to_chars for raw_vitals_log.csv or copying them
+// into the mapped raw_vitals_log.bin, and writes once FLUSH_BYTES are buffered or
+// FLUSH_INTERVAL has passed. Flush is a durability barrier: it returns once every record
+// appended before it is written and synced. Append must only be called from one thread at a
+// time (SessionManager calls it under its mutex).
+struct RawLogWriter {
+    enum class Format { CSV, BINARY };
+
+    static constexpr size_t CAPACITY = 4096;  // Records, a power of two (over 2 minutes of samples)
+    static constexpr size_t WAKE_BATCH = 256; // Ring occupancy that wakes the writer before the interval
+    static constexpr size_t FLUSH_BYTES = 64 * 1024;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{1000};
+
+    Format format;
+    std::string path;
+    int fd = -1;                       // CSV output
+    vitals::RawVitalsFileWriter binary; // Binary output
+    std::vector<vitals::RawVitalsRecord> ring;
+    alignas(64) std::atomic<uint64_t> head{0}; // Records appended, advanced by Append
+    alignas(64) std::atomic<uint64_t> tail{0}; // Records taken, advanced by the writer
+    std::atomic<uint64_t> dropped{0};          // Appended while the ring was full, or lost to a full disk
+
+    std::mutex mtx;
+    std::condition_variable wake;   // Writer: batch ready, flush requested or stopping
+    std::condition_variable synced; // Flush callers: durable advanced
+    uint64_t flush_target = 0;      // Records a Flush caller waits for, guarded by mtx
+    uint64_t durable = 0;           // Records written and synced, guarded by mtx
+    bool stopping = false;
+    std::thread worker;
+
+    explicit RawLogWriter(Format f)
+        : format(f), path(f == Format::BINARY ? "raw_vitals_log.bin" : "raw_vitals_log.csv"), ring(CAPACITY) {
+        if (format == Format::BINARY) {
+            if (!binary.Open(path.c_str())) return;
+        } else {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd == -1) return;
+            WriteAll(vitals::RAW_VITALS_CSV_HEADER, std::strlen(vitals::RAW_VITALS_CSV_HEADER));
+        }
+        worker = std::thread(&RawLogWriter::Run, this);
+    }
+
+    ~RawLogWriter() {
+        if (!IsOpen()) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        if (fd != -1) ::close(fd);
+        binary.Close();
+    }
+
+    // RAW_VITALS_FORMAT=binary logs fixed-width records instead of CSV; vitals_export turns
+    // them back into the CSV layout.
+    static Format FormatFromEnv() {
+        const char* env = std::getenv("RAW_VITALS_FORMAT");
+        return (env && std::string(env) == "binary") ? Format::BINARY : Format::CSV;
+    }
+
+    bool IsOpen() const { return fd != -1 || binary.IsOpen(); }
+
+    // Never blocks. A full ring means the disk has stalled for minutes; the record is
+    // counted in `dropped` rather than stalling vitals processing.
+    bool Append(const vitals::RawVitalsRecord& record) {
+        if (!IsOpen()) return false;
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        if (h - t >= CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        ring[h & (CAPACITY - 1)] = record;
+        head.store(h + 1, std::memory_order_release);
+
+        // Only wake the writer once per batch; a missed wakeup is covered by FLUSH_INTERVAL
+        if (h + 1 - t == WAKE_BATCH) wake.notify_one();
+        return true;
+    }
+
+    void Flush() {
+        if (!IsOpen()) return;
+        std::unique_lock<std::mutex> lock(mtx);
+        uint64_t target = head.load(std::memory_order_acquire);
+        if (durable >= target) return;
+
+        flush_target = std::max(flush_target, target);
+        wake.notify_one();
+        synced.wait(lock, [&] { return durable >= target; });
+    }
+
+    void Run() {
+        std::string buffer;
+        buffer.reserve(FLUSH_BYTES + 4096);
+        auto last_write = std::chrono::steady_clock::now();
+
+        while (true) {
+            bool sync;
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait_for(lock, FLUSH_INTERVAL, [this] {
+                    return stopping || flush_target > durable
+                           || head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed) >= WAKE_BATCH;
+                });
+                sync = flush_target > durable;
+                stop = stopping;
+            }
+
+            // Everything appended so far, which covers any pending Flush target
+            uint64_t formatted = Drain(buffer);
+
+            auto now = std::chrono::steady_clock::now();
+            if (!buffer.empty()
+                && (sync || stop || buffer.size() >= FLUSH_BYTES || now - last_write >= FLUSH_INTERVAL)) {
+                WriteAll(buffer.data(), buffer.size());
+                buffer.clear();
+                last_write = now;
+            }
+
+            if (sync || stop) {
+                if (format == Format::BINARY) {
+                    binary.Sync();
+                } else {
+                    ::fdatasync(fd);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    durable = formatted;
+                }
+                synced.notify_all();
+            }
+
+            if (stop) return;
+        }
+    }
+
+    // Takes every appended record, formatting CSV rows into `buffer` or copying records
+    // into the binary file, and returns the new tail
+    uint64_t Drain(std::string& buffer) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+
+        if (format == Format::BINARY) {
+            while (t != h) {
+                size_t index = t & (CAPACITY - 1);
+                size_t n = std::min<uint64_t>(h - t, CAPACITY - index); // Up to the end of the ring
+                if (!binary.Append(&ring[index], n)) {
+                    std::cerr << "[ERROR] raw_vitals_log.bin could not grow: " << std::strerror(errno) << "\n";
+                    dropped.fetch_add(n, std::memory_order_relaxed);
+                }
+                t += n;
+            }
+        } else {
+            char line[vitals::RAW_VITALS_CSV_ROW_MAX];
+            for (; t != h; ++t) {
+                char* out = vitals::FormatCsvRow(ring[t & (CAPACITY - 1)], line);
+                buffer.append(line, out - line);
+            }
+        }
+
+        // Slots are only handed back once their records have been copied out
+        tail.store(h, std::memory_order_release);
+        return h;
+    }
+
+    void WriteAll(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[ERROR] raw_vitals_log write failed: " << std::strerror(errno) << "\n";
+                return;
+            }
+            data += written;
+            size -= (size_t)written;
+        }
+    }
 };
 
-// State management for logging
+// State management for logging. Commands are queued by the streamer's listener thread and
+// applied in order by `command_worker`, so /control replies at once and never waits on the
+// disk. Metrics arrive on the SDK thread, so session data is guarded by `mtx`.
 struct SessionManager {
-    bool is_recording = false;
-    int question_counter = 1;
+    std::atomic<bool> is_recording{false};
+    std::atomic<int> question_counter{1};
+    std::atomic<bool> start_recording{false}; // The container's recording flag must be switched on
     int session_sample_counter = 0; 
+    std::mutex mtx;
+
+    // Queued START/NEXT/STOP commands, guarded by command_mtx
+    static constexpr size_t MAX_QUEUED_COMMANDS = 16;
+    std::mutex command_mtx;
+    std::condition_variable command_ready;
+    std::deque<std::string> commands;
+    bool stopping = false;
+    int queued_question = 1;       // Session state once every queued command is applied
+    bool queued_recording = false;
+    std::thread command_worker;
     
     // Session data
     std::vector<float> session_pulses;
     std::vector<float> session_breathings;
     std::chrono::steady_clock::time_point start_time;
-    std::ofstream raw_log;
+    RawLogWriter raw_log{RawLogWriter::FormatFromEnv()};
+    int64_t last_timestamp = 0;
     
     // Aggregated Summaries
     std::vector<QuestionSummary> all_summaries;
     
-    // Stress Events
-    std::vector<StressEvent> stress_events;
+    // Stress Events, appended to stress_events.jsonl as they happen and folded into
+    // stress_events.json when a question ends. journal_mtx keeps lines whole while the
+    // command thread folds the journal and the metrics thread appends to it.
+    std::FILE* stress_journal = nullptr;
+    bool stress_journal_dirty = false; // Guarded by journal_mtx
+    std::mutex journal_mtx;
+    // Baselines span the whole interview; the floors on their spread are in BPM and breaths
+    // per minute.
+    vitals::StressMonitor pulse_stress{"Pulse", {100.0f, 95.0f}, 3.0};
+    vitals::StressMonitor breathing_stress{"Breathing", {20.0f, 18.0f}, 1.5};
 
     SessionManager() {
-        // Initialize Raw Log
-        raw_log.open("raw_vitals_log.csv", std::ios::out);
-        if (raw_log.is_open()) {
-            raw_log << "sample_index,question_number,timestamp,pulse_bpm,breathing_bpm,pulse_confidence\n";
-            raw_log.flush();
-            std::cout << "[INFO] Fresh raw_vitals_log.csv initialized.\n";
+        if (raw_log.IsOpen()) {
+            std::cout << "[INFO] Fresh " << raw_log.path << " initialized.\n";
         }
         
         // Clear previous analysis
@@ -77,51 +291,174 @@ struct SessionManager {
         std::ofstream stress_clear("stress_events.json", std::ios::out | std::ios::trunc);
         stress_clear << "[]";
         stress_clear.close();
+        stress_journal = std::fopen("stress_events.jsonl", "w");
+
+        command_worker = std::thread(&SessionManager::RunCommands, this);
+    }
+
+    ~SessionManager() {
+        {
+            std::lock_guard<std::mutex> lock(command_mtx);
+            stopping = true;
+        }
+        command_ready.notify_one();
+        command_worker.join(); // Applies commands still queued
+
+        if (!stress_journal) return;
+        if (is_recording) CloseStressEpisodes();
+        FinalizeStressEvents(); // Covers a session still recording at shutdown
+        std::fclose(stress_journal);
+    }
+
+    static bool IsCommand(const std::string& command) {
+        return command == "START" || command == "NEXT" || command == "STOP" || command.empty();
+    }
+
+    // Where a command leaves the session once applied, for the /control reply: the question
+    // being recorded, or the next one to be recorded when stopped
+    struct CommandAck {
+        int question_number = 0;
+        bool recording = false;
+    };
+
+    // Called on the listener thread. Returns false if the queue is full. Commands are applied
+    // in queue order, so `ack` is worked out here by the same rules as HandleCommand, before
+    // command_worker gets to the command.
+    bool QueueCommand(const std::string& command, CommandAck& ack) {
+        {
+            std::lock_guard<std::mutex> lock(command_mtx);
+            if (commands.size() >= MAX_QUEUED_COMMANDS) return false;
+            commands.push_back(command);
+
+            if (command == "STOP") {
+                if (queued_recording) queued_question++;
+                queued_recording = false;
+            } else if (command == "NEXT") {
+                if (queued_recording) queued_question++;
+                queued_recording = true;
+            } else {
+                queued_recording = true; // START, ignored while already recording
+            }
+            ack = {queued_question, queued_recording};
+        }
+        command_ready.notify_one();
+        return true;
+    }
+
+    void RunCommands() {
+        std::unique_lock<std::mutex> lock(command_mtx);
+        while (true) {
+            command_ready.wait(lock, [this] { return stopping || !commands.empty(); });
+            if (commands.empty()) return; // Stopping with nothing left to apply
+
+            std::string command = std::move(commands.front());
+            commands.pop_front();
+            lock.unlock();
+            HandleCommand(command);
+            lock.lock();
+        }
+    }
+
+    // Applies a command from the frontend on command_worker. An empty command means START.
+    void HandleCommand(const std::string& command) {
+        std::cout << "\nCommand Recvd: [" << command << "] "; // Debug
+
+        if (command == "STOP") {
+            if (is_recording) {
+                std::cout << "Stopping Session for Q" << question_counter << "\n";
+                EndSession(); 
+            } else {
+                std::cout << "Ignored STOP (Not recording)\n";
+            }
+        } 
+        else if (command == "NEXT") {
+            if (is_recording) {
+                std::cout << "Ending Q" << question_counter << " -> Starting Q" << (question_counter + 1) << "\n";
+                EndSession(); 
+                StartSession();
+            } else {
+                std::cout << "Ignored NEXT (Not recording, treating as START)\n";
+                StartSession();
+                start_recording = true;
+            }
+        }
+        else if (command == "START" || command.empty()) {
+            if (!is_recording) {
+                std::cout << "Starting new session Q" << question_counter << "\n";
+                StartSession();
+                start_recording = true;
+            } else {
+                std::cout << "Ignored START (Already recording)\n";
+            }
+        }
+        else {
+            std::cout << "Unknown command\n";
+        }
     }
 
     void StartSession() {
+        std::lock_guard<std::mutex> lock(mtx);
         if (is_recording) return; // Prevent double start
         is_recording = true;
         session_sample_counter = 0; // Reset for new question
         session_pulses.clear();
         session_breathings.clear();
+        pulse_stress.Reset();
+        breathing_stress.Reset();
         
         start_time = std::chrono::steady_clock::now();
         std::cout << "\n[SESSION START] Recording Question " << question_counter << "...\n";
     }
 
+    // Takes the question's results under `mtx` and does the disk work after releasing it, so
+    // ProcessMetrics never waits on the flush or the JSON writes at a question boundary.
     void EndSession() {
-        if (!is_recording) return;
+        QuestionSummary summary;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!is_recording) return;
 
-        is_recording = false;
-        auto end_time = std::chrono::steady_clock::now();
-        double duration = std::chrono::duration<double>(end_time - start_time).count();
+            is_recording = false;
+            auto end_time = std::chrono::steady_clock::now();
+            double duration = std::chrono::duration<double>(end_time - start_time).count();
+            CloseStressEpisodes();
 
-        if (session_pulses.empty()) {
-            std::cout << "[SESSION END] No data was collected for Q" << question_counter << ".\n";
-        } else {
             // Calculate Session Averages
             float avg_pulse = 0;
             for (float f : session_pulses) avg_pulse += f;
-            avg_pulse /= session_pulses.size();
+            if (!session_pulses.empty()) avg_pulse /= session_pulses.size();
 
             float avg_breathing = 0;
             for (float f : session_breathings) avg_breathing += f;
-            avg_breathing /= session_breathings.size();
+            if (!session_breathings.empty()) avg_breathing /= session_breathings.size();
 
-            std::cout << "\n[SESSION END] Summary for Question " << question_counter << ":\n";
-            std::cout << "  - Avg Pulse: " << std::fixed << std::setprecision(2) << avg_pulse << " BPM\n";
-            std::cout << "  - Avg Breathing: " << avg_breathing << " BPM\n";
-            std::cout << "  - Duration: " << std::setprecision(2) << duration << "s\n";
+            summary = {question_counter.load(), avg_pulse, avg_breathing, duration, session_pulses.size(),
+                       pulse_stress.baseline.Summary(), breathing_stress.baseline.Summary()};
+            question_counter++;
+        }
 
-            // Store Summary
-            all_summaries.push_back({question_counter, avg_pulse, avg_breathing, duration, session_pulses.size()});
+        // The question's raw samples and stress events are on disk before its summary is written
+        raw_log.Flush();
+        FinalizeStressEvents();
+        if (uint64_t dropped = raw_log.dropped.exchange(0)) {
+            std::cout << "[WARN] " << dropped << " raw log samples dropped, the disk could not keep up or is full\n";
+        }
 
-            // Write Aggregated JSON
-            WriteAggregatedJSON();
+        if (summary.sample_count == 0) {
+            std::cout << "[SESSION END] No data was collected for Q" << summary.question_number << ".\n";
+            return;
         }
 
-        question_counter++;
+        std::cout << "\n[SESSION END] Summary for Question " << summary.question_number << ":\n";
+        std::cout << "  - Avg Pulse: " << std::fixed << std::setprecision(2) << summary.avg_pulse << " BPM\n";
+        std::cout << "  - Avg Breathing: " << summary.avg_breathing << " BPM\n";
+        std::cout << "  - Duration: " << std::setprecision(2) << summary.duration << "s\n";
+
+        // Store Summary (only the command thread touches all_summaries)
+        all_summaries.push_back(summary);
+
+        // Write Aggregated JSON
+        WriteAggregatedJSON();
     }
 
     void WriteAggregatedJSON() {
@@ -135,37 +472,91 @@ struct SessionManager {
                          << "    \"avg_pulse\": " << s.avg_pulse << ",\n"
                          << "    \"avg_breathing\": " << s.avg_breathing << ",\n"
                          << "    \"session_duration_sec\": " << s.duration << ",\n"
-                         << "    \"sample_count\": " << s.sample_count << "\n"
+                         << "    \"sample_count\": " << s.sample_count << ",\n"
+                         << "    \"baseline\": {\n"
+                         << "      \"pulse\": " << BaselineJSON(s.pulse_baseline) << ",\n"
+                         << "      \"breathing\": " << BaselineJSON(s.breathing_baseline) << ",\n"
+                         << "      \"onset_z\": " << vitals::StressMonitor::ONSET_Z << ",\n"
+                         << "      \"offset_z\": " << vitals::StressMonitor::OFFSET_Z << "\n"
+                         << "    }\n"
                          << "  }" << (i < all_summaries.size() - 1 ? "," : "") << "\n";
             }
             json_out << "]\n";
             json_out.close();
-            std::cout << "[INFO] Updated interview_events.json with Q" << (question_counter) << " data.\n";
+            std::cout << "[INFO] Updated interview_events.json with Q" << all_summaries.back().question_number << " data.\n";
         }
     }
     
-    void RecordStressEvent(const StressEvent& event) {
-        stress_events.push_back(event);
-        
-        // Write/Update Stress JSON immediately
-        std::ofstream json_out("stress_events.json");
-        if (json_out.is_open()) {
-            json_out << "[\n";
-            for (size_t i = 0; i < stress_events.size(); ++i) {
-                const auto& s = stress_events[i];
-                json_out << "  {\n"
-                         << "    \"question_number\": " << s.question_number << ",\n"
-                         << "    \"time_offset_sec\": " << std::fixed << std::setprecision(2) << s.time_offset_sec << ",\n"
-                         << "    \"type\": \"" << s.type << "\",\n"
-                         << "    \"value\": " << s.value << "\n"
-                         << "  }" << (i < stress_events.size() - 1 ? "," : "") << "\n";
-            }
-            json_out << "]\n";
-            json_out.close();
+    static std::string BaselineJSON(const vitals::BaselineSummary& b) {
+        std::ostringstream out;
+        out << "{\"mean\": " << b.mean << ", \"stddev\": " << b.stddev << ", \"samples\": " << b.samples
+            << ", \"calibrated\": " << (b.calibrated ? "true" : "false") << "}";
+        return out.str();
+    }
+
+    // One line per event, so the cost does not grow with the number of events recorded
+    void RecordStressEvent(const vitals::StressEvent& event) {
+        if (!stress_journal) return;
+        std::lock_guard<std::mutex> lock(journal_mtx);
+        std::fprintf(stress_journal,
+                     "{\"question_number\": %d, \"time_offset_sec\": %.2f, \"type\": \"%s\", \"value\": %.2f, "
+                     "\"start_offset_sec\": %.2f, \"end_offset_sec\": %.2f, \"duration_sec\": %.2f, "
+                     "\"peak\": %.2f, \"mean\": %.2f, \"detection\": \"%s\", \"peak_z\": %.2f}\n",
+                     event.question_number, event.time_offset_sec, event.type.c_str(), event.value,
+                     event.start_offset_sec, event.end_offset_sec, event.end_offset_sec - event.start_offset_sec,
+                     event.peak, event.mean, event.adaptive ? "baseline" : "absolute", event.peak_z);
+        stress_journal_dirty = true;
+    }
+
+    // Reports episodes still open when the question ends
+    void CloseStressEpisodes() {
+        vitals::StressEvent episode;
+        if (pulse_stress.Close(question_counter, episode)) RecordStressEvent(episode);
+        if (breathing_stress.Close(question_counter, episode)) RecordStressEvent(episode);
+    }
+
+    void CheckStress(vitals::StressMonitor& monitor, double offset_sec, float value) {
+        vitals::StressEvent episode;
+        if (monitor.Update(question_counter, offset_sec, value, episode)) RecordStressEvent(episode);
+    }
+
+    // Rebuilds stress_events.json, the array dataAggregator.js reads, from the journal in one
+    // pass. Only the journal up to the flush is read, so a line the metrics thread is still
+    // writing is left for the next pass. The array is written aside and renamed into place so
+    // readers never see it half written.
+    void FinalizeStressEvents() {
+        if (!stress_journal) return;
+        long journal_size;
+        {
+            std::lock_guard<std::mutex> lock(journal_mtx);
+            if (!stress_journal_dirty) return;
+            std::fflush(stress_journal);
+            stress_journal_dirty = false;
+            journal_size = std::ftell(stress_journal);
         }
+
+        std::ifstream journal("stress_events.jsonl");
+        std::ofstream json_out("stress_events.tmp", std::ios::out | std::ios::trunc);
+        if (!journal.is_open() || !json_out.is_open()) return;
+
+        std::string line;
+        long consumed = 0;
+        bool first = true;
+        json_out << "[";
+        while (consumed < journal_size && std::getline(journal, line)) {
+            consumed += (long)line.size() + 1;
+            if (line.empty()) continue;
+            json_out << (first ? "\n  " : ",\n  ") << line;
+            first = false;
+        }
+        json_out << (first ? "]\n" : "\n]\n");
+        json_out.close();
+        std::error_code ec; // Also runs from the destructor, so failures must not throw
+        std::filesystem::rename("stress_events.tmp", "stress_events.json", ec);
     }
     
     void ProcessMetrics(const presage::physiology::MetricsBuffer& metrics) {
+        std::lock_guard<std::mutex> lock(mtx);
         if (!is_recording) return;
 
         float pulse = 0, breathing = 0, confidence = 0;
@@ -182,29 +573,31 @@ struct SessionManager {
             timestamp = it->timestamp();
             session_pulses.push_back(pulse);
             
-            // Stress Check Pulse > 100
-            if (pulse > 100.0f) {
-                RecordStressEvent({question_counter, offset_sec, "Pulse", pulse});
-            }
+            CheckStress(pulse_stress, offset_sec, pulse);
         }
+        int64_t breathing_timestamp = 0;
         if (has_breathing) {
-            breathing = metrics.breathing().rate().rbegin()->value();
+            auto it = metrics.breathing().rate().rbegin();
+            breathing = it->value();
+            breathing_timestamp = it->timestamp();
             session_breathings.push_back(breathing);
             
-            // Stress Check Breathing > 20
-            if (breathing > 20.0f) {
-                RecordStressEvent({question_counter, offset_sec, "Breathing", breathing});
-            }
+            CheckStress(breathing_stress, offset_sec, breathing);
         }
         
         session_sample_counter++;
 
-        // --- Raw Log ---
-        if (raw_log.is_open()) {
-            raw_log << session_sample_counter << "," << question_counter << "," << timestamp << "," 
-                    << pulse << "," << breathing << "," << confidence << "\n";
-            raw_log.flush();
+        // The binary log is searched by time, so its timestamps never go backwards: a sample
+        // without a pulse reading takes the breathing timestamp, and no record is stamped
+        // earlier than the one before it. The CSV keeps the SDK's values, 0 included, as before.
+        if (raw_log.format == RawLogWriter::Format::BINARY) {
+            if (!has_pulse && has_breathing) timestamp = breathing_timestamp;
+            timestamp = std::max(timestamp, last_timestamp);
+            last_timestamp = timestamp;
         }
+
+        // --- Raw Log --- (written and flushed in batches by the log writer thread)
+        raw_log.Append({session_sample_counter, question_counter.load(), timestamp, pulse, breathing, confidence});
     }
 };
 
@@ -218,8 +611,6 @@ public:
     }
 };
 
-#include <deque>
-
 // Helper struct for Data Smoothing (Simple Moving Average)
 struct Smoother {
     std::deque<float> history;
@@ -231,7 +622,7 @@ struct Smoother {
         if (new_val == 0) return 0; // Ignore zeros or handle them? For now, pass through or ignore. 
                                     // Actually, let's reset if 0 to avoid dragging down average?
                                     // Or just push. SmartSpectra returns 0 if no vitals.
-        if (new_val <= 1.0f) return 0; // Filter noise/initialization
+        if (!vitals::IsValidRate(new_val)) return 0; // Filter noise/initialization
 
         history.push_back(new_val);
         if (history.size() > window_size) history.pop_front();
@@ -242,16 +633,454 @@ struct Smoother {
     }
 };
 
+// Bounds the stream controller adapts within
+struct StreamBounds {
+    int min_quality = 40;
+    int max_quality = 90;
+    double min_scale = 0.5;
+    double max_scale = 1.0;
+    int min_fps = 10;
+    int max_fps = 30;
+    double latency_budget_ms = 100;  // Submit to publish, per frame
+    double cpu_budget = 0.25;        // Share of one core the encoder may use
+};
+
+// One encoded view of the camera feed. `width` is the output width before the controller's
+// scale is applied (0 keeps the source width); height follows the source aspect ratio.
+struct Rendition {
+    std::string path;
+    int width;
+    StreamBounds bounds;
+};
+
+// Pooled copies of camera frames, shared read-only by the rendition encoders so the SDK
+// thread copies each frame once however many renditions are watched. Encoders hold a slot
+// through its shared_ptr, so a slot is free again once the pool holds the only reference,
+// as in nadjieb::net::FramePool.
+typedef std::shared_ptr<const cv::Mat> SourceFrame;
+
+struct SourceFramePool {
+    std::vector<std::shared_ptr<cv::Mat>> slots;
+
+    explicit SourceFramePool(size_t size) {
+        for (size_t i = 0; i < size; ++i) slots.push_back(std::make_shared<cv::Mat>());
+    }
+
+    SourceFrame Copy(const cv::Mat& frame) {
+        for (auto& slot : slots) {
+            if (slot.use_count() == 1) {
+                // Pairs with the release of the last encoder reference on another thread
+                std::atomic_thread_fence(std::memory_order_acquire);
+                frame.copyTo(*slot);
+                return slot;
+            }
+        }
+        return std::make_shared<const cv::Mat>(frame.clone());
+    }
+};
+
+// Adjusts JPEG quality, output scale and target fps once per second. Under pressure
+// (latency over budget, encoder over its CPU share, or viewers of its own topic backing up,
+// so a slow /vitals or thumbnail viewer does not degrade the main feed) it steps down
+// quality first, then scale, then fps; after a few comfortable windows it steps back up in
+// reverse order. Quality and scale are only touched by the encoder thread, fps is read by
+// the video callback.
+struct StreamController {
+    StreamBounds bounds;
+    int quality;
+    double scale;
+    std::atomic<int> fps;
+
+    std::chrono::steady_clock::time_point window_start = std::chrono::steady_clock::now();
+    size_t window_frames = 0;
+    double window_encode_ms = 0; // Wall time, for the log
+    double window_cpu_ms = 0;    // Encoder thread CPU time, so preemption is not taken for load
+    double window_latency_ms = 0;
+    uint64_t last_dropped = 0;
+    int comfortable_windows = 0;
+
+    explicit StreamController(const StreamBounds& b)
+        : bounds(b), quality(b.max_quality), scale(b.max_scale), fps(b.max_fps) {}
+
+    void OnFrameEncoded(double encode_ms, double cpu_ms, double latency_ms, const nadjieb::net::TopicHandle& topic) {
+        window_frames++;
+        window_encode_ms += encode_ms;
+        window_cpu_ms += cpu_ms;
+        window_latency_ms = std::max(window_latency_ms, latency_ms);
+
+        auto now = std::chrono::steady_clock::now();
+        double window_s = std::chrono::duration<double>(now - window_start).count();
+        if (window_s < 1.0) return;
+
+        auto& metrics = topic->getMetrics();
+        int64_t clients_waiting = metrics.clients_waiting.value();
+        uint64_t frames_dropped = metrics.frames_dropped.value();
+        double cpu_share = window_cpu_ms / 1000.0 / window_s;
+        bool backlog = clients_waiting > 0 && frames_dropped > last_dropped;
+        bool pressure = window_latency_ms > bounds.latency_budget_ms || cpu_share > bounds.cpu_budget || backlog;
+        bool comfortable = window_latency_ms < bounds.latency_budget_ms / 2 && cpu_share < bounds.cpu_budget / 2 && !backlog;
+
+        bool changed = false;
+        if (pressure) {
+            comfortable_windows = 0;
+            changed = StepDown();
+        } else if (comfortable && ++comfortable_windows >= 3) {
+            comfortable_windows = 0;
+            changed = StepUp();
+        }
+
+        if (changed) {
+            std::cout << "\n[INFO] Stream adjusted - quality: " << quality << ", scale: " << std::fixed
+                      << std::setprecision(2) << scale << ", fps: " << fps << " (encode " << window_encode_ms / window_frames
+                      << " ms/frame, cpu " << cpu_share << ", max latency " << window_latency_ms << " ms, waiting "
+                      << clients_waiting << "/" << topic->getClients()->clients.size() << " on " << topic->getPath()
+                      << ")\n";
+        }
+
+        last_dropped = frames_dropped;
+        window_start = now;
+        window_frames = 0;
+        window_encode_ms = 0;
+        window_cpu_ms = 0;
+        window_latency_ms = 0;
+    }
+
+    bool StepDown() {
+        if (quality > bounds.min_quality) {
+            quality = std::max(bounds.min_quality, quality - 10);
+        } else if (scale > bounds.min_scale) {
+            scale = std::max(bounds.min_scale, scale - 0.25);
+        } else if (fps > bounds.min_fps) {
+            fps = std::max(bounds.min_fps, fps - 5);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool StepUp() {
+        if (fps < bounds.max_fps) {
+            fps = std::min(bounds.max_fps, fps + 5);
+        } else if (scale < bounds.max_scale) {
+            scale = std::min(bounds.max_scale, scale + 0.25);
+        } else if (quality < bounds.max_quality) {
+            quality = std::min(bounds.max_quality, quality + 10);
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Latest-only encode stage between the SDK video callback and the streamer, one per rendition.
+// Submit hands over a shared source frame and returns; a dedicated thread resizes, encodes and
+// publishes it, so renditions run on separate cores. A frame that is still pending when the
+// next one arrives is replaced and counted as dropped. Counters and timings are registered on
+// the streamer's /metrics, labelled with the rendition path.
+struct StreamEncoder {
+    nadjieb::MJPEGStreamer& streamer;
+    Rendition rendition;
+    nadjieb::net::TopicHandle topic;
+    StreamController controller;
+
+    nadjieb::utils::Counter& frames_encoded;
+    nadjieb::utils::Counter& frames_dropped;
+    nadjieb::utils::Counter& encode_cpu_us;
+    nadjieb::utils::Histogram& encode_seconds;   // Resize, encode and publish, wall time
+    nadjieb::utils::Histogram& latency_seconds;  // Submit to publish
+    nadjieb::utils::Gauge& target_fps;
+    nadjieb::utils::Gauge& target_quality;
+
+    std::mutex mtx;
+    std::condition_variable ready;
+    SourceFrame pending;  // Written by Submit, swapped out by the encoder thread
+    std::chrono::steady_clock::time_point pending_since;
+    std::chrono::steady_clock::time_point last_submit;
+    bool has_pending = false;
+    bool stopping = false;
+    std::thread worker;
+
+    StreamEncoder(nadjieb::MJPEGStreamer& s, const Rendition& r)
+        : streamer(s), rendition(r), topic(s.registerTopic(r.path)), controller(r.bounds),
+          frames_encoded(s.getMetrics().counter("vitals_encoder_frames_total", "Frames encoded and published.", Label(r))),
+          frames_dropped(s.getMetrics().counter("vitals_encoder_frames_dropped_total",
+                                                "Frames replaced before the encoder picked them up.", Label(r))),
+          encode_cpu_us(s.getMetrics().counter("vitals_encoder_cpu_microseconds_total",
+                                               "CPU time spent by the encoder thread.", Label(r))),
+          encode_seconds(s.getMetrics().histogram("vitals_encode_seconds", "Time to resize, encode and publish a frame.",
+                                                  nadjieb::utils::Histogram::latencyBounds(), Label(r))),
+          latency_seconds(s.getMetrics().histogram("vitals_encode_latency_seconds",
+                                                   "Time from handing a frame to the encoder until it is published.",
+                                                   nadjieb::utils::Histogram::latencyBounds(), Label(r))),
+          target_fps(s.getMetrics().gauge("vitals_stream_target_fps", "Frame rate the controller currently targets.", Label(r))),
+          target_quality(s.getMetrics().gauge("vitals_stream_jpeg_quality", "JPEG quality the controller currently uses.", Label(r))) {
+        target_fps.set(controller.fps);
+        target_quality.set(controller.quality);
+        worker = std::thread(&StreamEncoder::Run, this);
+    }
+
+    ~StreamEncoder() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join();
+    }
+
+    // A snapshot poller counts as a viewer for this long after each request, so snapshot.jpg
+    // stays fresh with no stream open
+    static constexpr std::chrono::seconds SNAPSHOT_DEMAND{5};
+
+    bool Watched() const { return streamer.hasClient(topic) || streamer.hasSnapshotDemand(topic, SNAPSHOT_DEMAND); }
+
+    // True if the rendition is due a frame at the controller's target fps. Checked before
+    // the source copy so skipped frames cost the SDK thread nothing.
+    bool Due(std::chrono::steady_clock::time_point now) {
+        // 10% slack so camera jitter at the source rate does not halve the stream
+        if (now - last_submit < std::chrono::microseconds(900000 / controller.fps)) return false;
+        last_submit = now;
+        return true;
+    }
+
+    void Submit(const SourceFrame& source, std::chrono::steady_clock::time_point now) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending = source; // Shares the pooled copy, only the encoder thread reads it
+            pending_since = now;
+            if (has_pending) frames_dropped.add();
+            has_pending = true;
+        }
+        ready.notify_one();
+    }
+
+    void Run() {
+        SourceFrame working;
+        cv::Mat scaled;
+        std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, controller.quality};
+        std::chrono::steady_clock::time_point submitted;
+        nadjieb::net::FramePool frame_pool(8, 256 * 1024); // Encode buffers reused once viewers release them
+        frame_pool.prefill();
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                ready.wait(lock, [this] { return has_pending || stopping; });
+                if (stopping) return;
+                working = std::move(pending);
+                submitted = pending_since;
+                has_pending = false;
+            }
+
+            double cpu_start = ThreadCpuMs();
+            auto encode_start = std::chrono::steady_clock::now();
+
+            const cv::Mat* source = working.get();
+            int width = (int)((rendition.width > 0 ? rendition.width : source->cols) * controller.scale);
+            if (width < source->cols) {
+                int height = std::max(1, source->rows * width / source->cols);
+                cv::resize(*source, scaled, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+                source = &scaled;
+            }
+
+            params[1] = controller.quality;
+            auto frame = frame_pool.acquire();
+            cv::imencode(".jpg", *source, frame->getBuffer(), params);
+            frame->seal();
+            streamer.publish(topic, std::move(frame));
+            working.reset(); // Lets the source pool reuse the slot
+
+            auto done = std::chrono::steady_clock::now();
+            double cpu_ms = ThreadCpuMs() - cpu_start;
+            encode_cpu_us.add((uint64_t)(cpu_ms * 1e3));
+            frames_encoded.add();
+            encode_seconds.observe(std::chrono::duration<double>(done - encode_start).count());
+            latency_seconds.observe(std::chrono::duration<double>(done - submitted).count());
+
+            controller.OnFrameEncoded(std::chrono::duration<double, std::milli>(done - encode_start).count(), cpu_ms,
+                                      std::chrono::duration<double, std::milli>(done - submitted).count(), topic);
+            target_fps.set(controller.fps);
+            target_quality.set(controller.quality);
+        }
+    }
+
+    static std::string Label(const Rendition& r) { return nadjieb::utils::MetricsRegistry::label("rendition", r.path); }
+
+    static double ThreadCpuMs() {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+    }
+};
+
+// Per-frame CPU time of the video callback, split by whether anyone was watching the feed
+struct VideoFrameStats {
+    struct Bucket {
+        size_t frames = 0;
+        double cpu_ms = 0;
+    };
+
+    Bucket watched;
+    Bucket idle;
+    bool was_watched = false;
+    std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+    // Encoder counters at the previous report, one entry per rendition
+    struct EncoderTotals {
+        uint64_t encoded = 0;
+        uint64_t dropped = 0;
+        uint64_t cpu_us = 0;
+    };
+    std::vector<EncoderTotals> last_totals;
+
+    void Record(bool has_viewers, double cpu_ms, const std::vector<std::unique_ptr<StreamEncoder>>& encoders) {
+        Bucket& bucket = has_viewers ? watched : idle;
+        bucket.frames++;
+        bucket.cpu_ms += cpu_ms;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(10)) {
+            Report(encoders);
+            last_report = now;
+        }
+    }
+
+    void Report(const std::vector<std::unique_ptr<StreamEncoder>>& encoders) {
+        std::cout << "\n[INFO] Video callback CPU/frame - watched: " << std::fixed << std::setprecision(2)
+                  << Average(watched) << " ms (" << watched.frames << " frames), idle: "
+                  << Average(idle) << " ms (" << idle.frames << " frames)\n";
+
+        last_totals.resize(encoders.size());
+        for (size_t i = 0; i < encoders.size(); ++i) {
+            EncoderTotals totals{encoders[i]->frames_encoded.value(), encoders[i]->frames_dropped.value(),
+                                 encoders[i]->encode_cpu_us.value()};
+            Bucket encode{(size_t)(totals.encoded - last_totals[i].encoded), (totals.cpu_us - last_totals[i].cpu_us) / 1e3};
+
+            std::cout << "[INFO]   " << encoders[i]->rendition.path << " encoder: " << Average(encode) << " ms ("
+                      << encode.frames << " encoded, " << (totals.dropped - last_totals[i].dropped) << " dropped)\n";
+            last_totals[i] = totals;
+        }
+
+        watched = Bucket();
+        idle = Bucket();
+    }
+
+    static double Average(const Bucket& bucket) {
+        return bucket.frames == 0 ? 0 : bucket.cpu_ms / bucket.frames;
+    }
+};
+
+// Observes the time from construction to the end of the enclosing scope, so every return
+// path of a callback is timed
+struct ScopedTimer {
+    nadjieb::utils::Histogram& histogram;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    explicit ScopedTimer(nadjieb::utils::Histogram& h) : histogram(h) {}
+    ~ScopedTimer() { histogram.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()); }
+};
+
+// Command from a /control request body: either {"action": "NEXT"} or the bare word
+std::string ParseControlCommand(std::string_view body) {
+    auto key = body.find("\"action\"");
+    if (key != std::string_view::npos) {
+        auto open = body.find('"', body.find(':', key));
+        auto close = (open == std::string_view::npos) ? open : body.find('"', open + 1);
+        if (close == std::string_view::npos) return "INVALID";
+        body = body.substr(open + 1, close - open - 1);
+    } else if (!body.empty() && body.front() == '{') {
+        return ""; // JSON without an action means START
+    }
+
+    while (!body.empty() && std::isspace((unsigned char)body.front())) body.remove_prefix(1);
+    while (!body.empty() && std::isspace((unsigned char)body.back())) body.remove_suffix(1);
+    return std::string(body);
+}
+
+// Who may send /control. The streamer listens on every interface and any page the candidate
+// opens can post to it, so a command must carry the shared token in X-Control-Token and be
+// sent as application/json. A browser cannot send that cross-origin without a preflight, which
+// the streamer does not answer. A request that does come from a browser must also come from
+// the frontend's origin.
+struct ControlAuth {
+    static constexpr const char* TOKEN_FILE = "control_token";
+
+    std::string token;
+    std::string origin;
+
+    // The token is VITALS_CONTROL_TOKEN, or else a fresh random one written to TOKEN_FILE (mode
+    // 0600) for the Next.js API route to read. The origin is VITALS_FRONTEND_ORIGIN, by default
+    // http://localhost:3000.
+    static ControlAuth FromEnv() {
+        ControlAuth auth;
+        const char* origin_env = std::getenv("VITALS_FRONTEND_ORIGIN");
+        auth.origin = (origin_env && *origin_env) ? origin_env : "http://localhost:3000";
+
+        const char* token_env = std::getenv("VITALS_CONTROL_TOKEN");
+        if (token_env && *token_env) {
+            auth.token = token_env;
+            return auth;
+        }
+
+        std::random_device random;
+        char hex[33];
+        for (int i = 0; i < 4; ++i) std::snprintf(hex + 8 * i, 9, "%08x", (unsigned)random());
+        auth.token.assign(hex, 32);
+
+        int fd = ::open(TOKEN_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd == -1 || ::write(fd, auth.token.data(), auth.token.size()) != (ssize_t)auth.token.size()) {
+            std::cerr << "[WARN] Cannot write " << TOKEN_FILE << ", /control will reject the frontend: "
+                      << std::strerror(errno) << "\n";
+        }
+        if (fd != -1) ::close(fd);
+        return auth;
+    }
+
+    // Returns 0 if the request may run a command, or else the status to reject it with
+    int Check(const nadjieb::net::HTTPRequest& req, std::string& error) const {
+        auto request_origin = req.getValue("Origin");
+        if (!request_origin.empty() && request_origin != origin) {
+            error = "origin not allowed";
+            return 403;
+        }
+
+        auto content_type = req.getValue("Content-Type");
+        content_type = content_type.substr(0, content_type.find(';'));
+        while (!content_type.empty() && std::isspace((unsigned char)content_type.back())) content_type.remove_suffix(1);
+        if (!EqualsIgnoreCase(content_type, "application/json")) {
+            error = "content type must be application/json";
+            return 415;
+        }
+
+        if (!TokenMatches(req.getValue("X-Control-Token"))) {
+            error = "missing or wrong control token";
+            return 401;
+        }
+        return 0;
+    }
+
+    // Compares in time independent of where the first difference is
+    bool TokenMatches(std::string_view candidate) const {
+        if (candidate.size() != token.size()) return false;
+        unsigned char diff = 0;
+        for (size_t i = 0; i < token.size(); ++i) diff |= (unsigned char)(candidate[i] ^ token[i]);
+        return diff == 0;
+    }
+
+    static bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+        }
+        return true;
+    }
+};
+
 int main(int argc, char** argv) {
     // Initialize logging
     google::InitGoogleLogging(argv[0]);
     FLAGS_alsologtostderr = true;
 
-    // Cleanup stale trigger file
-    if (std::filesystem::exists("../vitals_trigger.tmp")) {
-        std::filesystem::remove("../vitals_trigger.tmp");
-    }
-    
     // Get API key
     std::string api_key;
     if (argc > 1) {
@@ -264,6 +1093,7 @@ int main(int argc, char** argv) {
     }
     
     SessionManager session_manager;
+    VideoFrameStats video_stats;
     
     // Create Smoothers
     // Window size 10 (approx 0.3-0.5s) for responsive yet stable readings
@@ -295,13 +1125,92 @@ int main(int argc, char** argv) {
         auto container = std::make_unique<ExposedContainer>(settings);
         auto hud = std::make_unique<gui::OpenCvHud>(10, 0, 1260, 400);
         
+        ControlAuth control_auth = ControlAuth::FromEnv(); // Outlives the streamer's /control route
+
         // Initialize MJPEG Streamer
         nadjieb::MJPEGStreamer streamer;
+        streamer.setDeliveryMode(nadjieb::net::DeliveryMode::LATEST); // Viewers always get the freshest frame
+
+        // Renditions of the camera feed, each encoded on its own thread only while watched
+        StreamBounds thumb_bounds;
+        thumb_bounds.min_quality = 50;
+        thumb_bounds.max_quality = 75;
+        thumb_bounds.min_scale = 1.0;
+        thumb_bounds.min_fps = 2;
+        thumb_bounds.max_fps = 10;
+
+        std::vector<Rendition> renditions = {
+            {"/video_feed", 0, StreamBounds()},
+            {"/video_feed/640", 640, StreamBounds()},
+            {"/video_feed/thumb", 160, thumb_bounds},
+        };
+
+        // Smoothed vitals pushed to the frontend as server-sent events
+        auto vitals_events = streamer.registerEventTopic("/vitals");
+
+        // The latest_vitals.json handoff is only needed by the polling fallback;
+        // VITALS_FILE_EXPORT=0 turns it off.
+        const char* file_export_env = std::getenv("VITALS_FILE_EXPORT");
+        bool vitals_file_export = !(file_export_env && std::string(file_export_env) == "0");
+
+        // SDK callback timings, served with the streamer's own metrics on /metrics
+        auto& metrics_callback_seconds = streamer.getMetrics().histogram(
+            "vitals_metrics_callback_seconds", "Time spent in the core metrics callback.");
+        auto& video_callback_seconds = streamer.getMetrics().histogram(
+            "vitals_video_callback_seconds", "Time spent in the video callback.");
+
+        std::vector<std::unique_ptr<StreamEncoder>> stream_encoders;
+        for (const auto& rendition : renditions) {
+            stream_encoders.emplace_back(new StreamEncoder(streamer, rendition));
+        }
+        SourceFramePool source_pool(2 * renditions.size() + 1); // Pending and in-encode per rendition
+
+        // Session commands from the frontend, queued for the session manager and acknowledged
+        // straight away with the question they leave the session on
+        streamer.addRoute("POST", "/control", [&session_manager, &control_auth](const nadjieb::net::HTTPRequest& req) {
+            nadjieb::RouteResponse res;
+            std::string error;
+            if (int status = control_auth.Check(req, error)) {
+                res.status_code = status;
+                res.status_text = (status == 403) ? "Forbidden" : (status == 415) ? "Unsupported Media Type" : "Unauthorized";
+                res.body = "{\"error\": \"" + error + "\"}";
+                return res;
+            }
+
+            std::string command = ParseControlCommand(req.getBody());
+            if (!SessionManager::IsCommand(command)) {
+                res.status_code = 400;
+                res.status_text = "Bad Request";
+                res.body = "{\"error\": \"unknown command\"}";
+                return res;
+            }
+            SessionManager::CommandAck ack;
+            if (!session_manager.QueueCommand(command, ack)) {
+                res.status_code = 503;
+                res.status_text = "Service Unavailable";
+                res.body = "{\"error\": \"too many queued commands\"}";
+                return res;
+            }
+
+            res.status_code = 202;
+            res.status_text = "Accepted";
+            res.body = "{\"action\": \"" + (command.empty() ? std::string("START") : command) +
+                       "\", \"queued\": true, \"question_number\": " + std::to_string(ack.question_number) +
+                       ", \"recording\": " + (ack.recording ? "true" : "false") + "}";
+            return res;
+        });
+
         streamer.start(8080);
-        std::cout << "MJPEG Streamer started on http://localhost:8080/video_feed\n";
+        for (const auto& rendition : renditions) {
+            std::cout << "MJPEG Streamer started on http://localhost:8080" << rendition.path << "\n";
+        }
+        std::cout << "Vitals events on http://localhost:8080/vitals (file export "
+                  << (vitals_file_export ? "ON" : "OFF") << ")\n";
+        std::cout << "Metrics on http://localhost:8080/metrics\n";
 
         auto status = container->SetOnCoreMetricsOutput(
-            [&hud, &session_manager, &pulse_smoother, &breathing_smoother](const presage::physiology::MetricsBuffer& metrics, int64_t timestamp) {
+            [&hud, &session_manager, &pulse_smoother, &breathing_smoother, &streamer, &vitals_events, vitals_file_export, &metrics_callback_seconds](const presage::physiology::MetricsBuffer& metrics, int64_t timestamp) {
+                ScopedTimer timer(metrics_callback_seconds);
                 bool has_data = !metrics.pulse().rate().empty() && !metrics.breathing().rate().empty();
                 
                 // Get Raw Values
@@ -328,7 +1237,16 @@ int main(int argc, char** argv) {
 
                 hud->UpdateWithNewMetrics(metrics);
                 
-                // Export real-time SMOOTHED vitals to JSON for frontend
+                // Push real-time SMOOTHED vitals to the frontend
+                char vitals_json[128];
+                int vitals_len = std::snprintf(vitals_json, sizeof(vitals_json),
+                                               "{\"pulse\": %.1f, \"breathing\": %.1f, \"recording\": %s}",
+                                               smoothed_pulse, smoothed_breathing,
+                                               session_manager.is_recording ? "true" : "false");
+                streamer.publishEvent(vitals_events, std::string_view(vitals_json, vitals_len));
+
+                // File handoff for the polling fallback
+                if (!vitals_file_export) return absl::OkStatus();
                 std::ofstream vitals_file("../vitals.tmp");
                 if (vitals_file.is_open()) {
                     vitals_file << "{\n"
@@ -348,7 +1266,10 @@ int main(int argc, char** argv) {
         auto* raw_container = container.get();
 
         status = container->SetOnVideoOutput(
-            [&hud, &session_manager, &streamer, raw_container](cv::Mat& frame, int64_t timestamp) {
+            [&hud, &session_manager, &video_stats, &stream_encoders, &source_pool, raw_container, &video_callback_seconds](cv::Mat& frame, int64_t timestamp) {
+                ScopedTimer timer(video_callback_seconds);
+                double cpu_start = StreamEncoder::ThreadCpuMs();
+
                 // HUD disabled for raw feed
                 // hud->Render(frame).IgnoreError();
                 
@@ -359,55 +1280,31 @@ int main(int argc, char** argv) {
                                 cv::Point(70, 60), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 255), 2);
                 }
 
-                // Stream frame
-                std::vector<uchar> buff_bgr;
-                cv::imencode(".jpg", frame, buff_bgr);
-                std::string content(buff_bgr.begin(), buff_bgr.end());
-                streamer.publish("/video_feed", content);
-
-                // Remote Trigger Check (Enhanced with Commands)
-                if (std::filesystem::exists("../vitals_trigger.tmp")) {
-                    std::ifstream trigger_in("../vitals_trigger.tmp");
-                    std::string command;
-                    if (trigger_in.is_open()) {
-                        std::getline(trigger_in, command);
-                        trigger_in.close();
-                    }
-                    
-                    std::cout << "Trigger Recvd: [" << command << "] "; // Debug
-
-                    if (command == "STOP") {
-                        if (session_manager.is_recording) {
-                            std::cout << "Stopping Session for Q" << session_manager.question_counter << "\n";
-                            session_manager.EndSession(); 
-                        } else {
-                            std::cout << "Ignored STOP (Not recording)\n";
-                        }
-                    } 
-                    else if (command == "NEXT") {
-                        if (session_manager.is_recording) {
-                            std::cout << "Ending Q" << session_manager.question_counter << " -> Starting Q" << (session_manager.question_counter + 1) << "\n";
-                            session_manager.EndSession(); 
-                            session_manager.StartSession();
-                        } else {
-                            std::cout << "Ignored NEXT (Not recording, treating as START)\n";
-                            session_manager.StartSession();
-                            raw_container->SetRecordingPublic(true);
-                        }
-                    }
-                    else { // Default "START" or empty
-                        if (!session_manager.is_recording) {
-                            std::cout << "Starting new session Q" << session_manager.question_counter << "\n";
-                            session_manager.StartSession();
-                            raw_container->SetRecordingPublic(true);
-                        } else {
-                            std::cout << "Ignored START (Already recording)\n";
-                        }
-                    }
-                    
-                    std::filesystem::remove("../vitals_trigger.tmp");
+                // Stream frame (copied once and shared by the renditions that are watched and due)
+                auto now = std::chrono::steady_clock::now();
+                bool has_viewers = false;
+                SourceFrame source;
+                for (auto& encoder : stream_encoders) {
+                    if (!encoder->Watched()) continue;
+                    has_viewers = true;
+                    if (!encoder->Due(now)) continue;
+                    if (!source) source = source_pool.Copy(frame);
+                    encoder->Submit(source, now);
+                }
+
+                if (has_viewers != video_stats.was_watched) {
+                    std::cout << "\n[INFO] " << (has_viewers ? "Viewer connected, resuming" : "No viewers, pausing")
+                              << " video encoding\n";
+                    video_stats.was_watched = has_viewers;
                 }
 
+                // Switch the container to recording once a command asked for it
+                if (session_manager.start_recording.load() && session_manager.start_recording.exchange(false)) {
+                    raw_container->SetRecordingPublic(true);
+                }
+
+                video_stats.Record(has_viewers, StreamEncoder::ThreadCpuMs() - cpu_start, stream_encoders);
+
                 return absl::OkStatus();
             }
         ); 
@@ -417,7 +1314,7 @@ int main(int argc, char** argv) {
             return 1;
         }
         
-        std::cout << "Ready! Waiting for Frontend Triggers (START, NEXT, STOP) or press 'q' to quit.\n";
+        std::cout << "Ready! Waiting for Frontend Commands (POST /control: START, NEXT, STOP) or press 'q' to quit.\n";
         container->Run().IgnoreError();
         
         cv::destroyAllWindows();
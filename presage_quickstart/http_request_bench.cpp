@@ -0,0 +1,172 @@
+// http_request_bench.cpp
+// Microbenchmark of the streamer's HTTP request parser against the istringstream parser it
+// replaced: the time to parse the requests the frontend actually sends, whole and as they
+// trickle in over a slow connection.
+
+#include <nadjieb/net/http_request.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace legacy {
+// The parser as it was before the incremental one, kept verbatim for comparison. It parsed a
+// whole message, which the listener assembled by appending each read to a std::string.
+class HTTPRequest {
+   public:
+    HTTPRequest(const std::string& message) { parse(message); }
+
+    void parse(const std::string& message) {
+        std::istringstream iss(message);
+
+        std::getline(iss, method_, ' ');
+        std::getline(iss, target_, ' ');
+        std::getline(iss, version_, '\r');
+
+        std::string line;
+        std::getline(iss, line);
+
+        while (true) {
+            std::getline(iss, line);
+            if (line == "\r") {
+                break;
+            }
+
+            std::string key;
+            std::string value;
+            std::istringstream iss_header(line);
+            std::getline(iss_header, key, ':');
+            std::getline(iss_header, value, ' ');
+            std::getline(iss_header, value, '\r');
+
+            headers_[key] = value;
+        }
+
+        body_ = iss.str().substr(iss.tellg());
+    }
+
+    const std::string& getMethod() const { return method_; }
+
+    const std::string& getTarget() const { return target_; }
+
+    const std::string& getVersion() const { return version_; }
+
+    const std::string& getValue(const std::string& key) { return headers_[key]; }
+
+    const std::string& getBody() const { return body_; }
+
+   private:
+    std::string method_;
+    std::string target_;
+    std::string version_;
+    std::unordered_map<std::string, std::string> headers_;
+    std::string body_;
+};
+} // namespace legacy
+
+namespace {
+
+// Parses `message` `iterations` times, fed in `chunk`-byte pieces (0 feeds it whole), and
+// returns the average nanoseconds per request
+double Measure(const std::string& message, size_t chunk, int iterations, size_t& sink) {
+    nadjieb::net::HTTPRequest req;
+    if (chunk == 0) chunk = message.size();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        req.reset();
+        for (size_t offset = 0; offset < message.size(); offset += chunk) {
+            req.parse(message.data() + offset, std::min(chunk, message.size() - offset));
+        }
+        if (req.getStatus() != nadjieb::net::HTTPRequest::ParseStatus::COMPLETE) {
+            std::cerr << "Error: request did not parse\n";
+            std::exit(1);
+        }
+        sink += req.getPath().size() + req.getValue("Host").size() + req.getBody().size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// The same with the legacy parser, reads assembled into a string the way its listener did
+double MeasureLegacy(const std::string& message, size_t chunk, int iterations, size_t& sink) {
+    if (chunk == 0) chunk = message.size();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        std::string data;
+        for (size_t offset = 0; offset < message.size(); offset += chunk) {
+            data += message.substr(offset, std::min(chunk, message.size() - offset));
+        }
+        legacy::HTTPRequest req(data);
+        if (req.getVersion() != "HTTP/1.1") {
+            std::cerr << "Error: legacy request did not parse\n";
+            std::exit(1);
+        }
+        sink += req.getTarget().size() + req.getValue("Host").size() + req.getBody().size();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 200000;
+    if (iterations <= 0) {
+        std::cerr << "Usage: ./http_request_bench [ITERATIONS]\n";
+        return 1;
+    }
+
+    const std::string video_feed =
+        "GET /video_feed?fps=15&maxlag=200 HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+        "Accept: image/avif,image/webp,image/apng,image/*,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.9\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Connection: keep-alive\r\n"
+        "Referer: http://localhost:3000/interview\r\n"
+        "\r\n";
+    const std::string control =
+        "POST /control HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 18\r\n"
+        "Origin: http://localhost:3000\r\n"
+        "\r\n"
+        "{\"action\": \"NEXT\"}";
+
+    struct Case {
+        const char* name;
+        const std::string& message;
+        size_t chunk;
+    };
+    const Case cases[] = {
+        {"GET /video_feed, whole", video_feed, 0},
+        {"GET /video_feed, 16-byte reads", video_feed, 16},
+        {"POST /control, whole", control, 0},
+        {"POST /control, 16-byte reads", control, 16},
+    };
+
+    size_t sink = 0;
+    std::cout << std::left << std::setw(34) << "ns/request" << std::right << std::setw(10) << "legacy"
+              << std::setw(10) << "current" << std::setw(10) << "speedup" << "\n";
+    for (const auto& c : cases) {
+        int warmup = std::max(1, iterations / 10);
+        MeasureLegacy(c.message, c.chunk, warmup, sink);
+        double legacy_ns = MeasureLegacy(c.message, c.chunk, iterations, sink);
+        Measure(c.message, c.chunk, warmup, sink);
+        double ns = Measure(c.message, c.chunk, iterations, sink);
+        std::cout << std::left << std::setw(34) << c.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << legacy_ns << std::setw(10) << ns << std::setw(9) << legacy_ns / ns << "x\n";
+    }
+
+    // Keeps the parse results observable so the loops are not optimized away
+    return (sink == 0) ? 1 : 0;
+}
@@ -29,23 +29,51 @@ SOFTWARE.
 
 #include <nadjieb/utils/version.hpp>
 
+#include <nadjieb/net/frame.hpp>
+#include <nadjieb/net/frame_pool.hpp>
 #include <nadjieb/net/http_request.hpp>
 #include <nadjieb/net/http_response.hpp>
 #include <nadjieb/net/listener.hpp>
 #include <nadjieb/net/publisher.hpp>
+#include <nadjieb/net/response_cache.hpp>
 #include <nadjieb/net/socket.hpp>
+#include <nadjieb/utils/metrics.hpp>
 #include <nadjieb/utils/non_copyable.hpp>
 
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace nadjieb {
+// Reply of a route handler, sent with a Content-Length and the connection closed after it.
+struct RouteResponse {
+    int status_code = 200;
+    std::string status_text = "OK";
+    std::string content_type = "application/json";
+    std::string body;
+};
+
+using RouteHandler = std::function<RouteResponse(const nadjieb::net::HTTPRequest&)>;
+
 class MJPEGStreamer : public nadjieb::utils::NonCopyable {
    public:
+    MJPEGStreamer() {
+        buildResponses();
+        registerMetrics();
+    }
+
     virtual ~MJPEGStreamer() { stop(); }
 
-    void start(int port, int num_workers = std::thread::hardware_concurrency()) {
+    void start(int port, int num_workers = nadjieb::net::Publisher::defaultNumWorkers()) {
         publisher_.start(num_workers);
-        listener_.withOnMessageCallback(on_message_cb_).withOnBeforeCloseCallback(on_before_close_cb_).runAsync(port);
+        listener_.withOnMessageCallback(on_message_cb_)
+            .withOnBeforeCloseCallback(on_before_close_cb_)
+            .withEngine(listener_engine_)
+            .runAsync(port);
 
         while (!isRunning()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -57,32 +85,366 @@ class MJPEGStreamer : public nadjieb::utils::NonCopyable {
         listener_.stop();
     }
 
-    void publish(const std::string& path, const std::string& buffer) { publisher_.enqueue(path, buffer); }
+    void publish(const std::string& path, const std::string& buffer) {
+        publish(path, nadjieb::net::makeFrame(buffer));
+    }
+
+    void publish(const std::string& path, nadjieb::net::FramePtr frame) {
+        publisher_.enqueue(path, std::move(frame));
+    }
+
+    // Registers `path` ahead of time so clients can connect before the first frame, and
+    // returns a handle that publishes without looking the path up again.
+    nadjieb::net::TopicHandle registerTopic(const std::string& path) { return publisher_.registerTopic(path); }
+
+    void publish(const nadjieb::net::TopicHandle& topic, const std::string& buffer) {
+        publish(topic, nadjieb::net::makeFrame(buffer));
+    }
+
+    // Hands a frame over by ownership. Frames acquired from a FramePool and encoded in
+    // place are published without copying or allocating.
+    void publish(const nadjieb::net::TopicHandle& topic, nadjieb::net::FramePtr frame) {
+        publisher_.enqueue(topic, std::move(frame));
+    }
+
+    // Registers `path` as a text/event-stream endpoint. Viewers of other origins may connect,
+    // so browsers can use EventSource from a page served elsewhere.
+    nadjieb::net::TopicHandle registerEventTopic(const std::string& path) {
+        return publisher_.registerTopic(path, nadjieb::net::TopicType::EVENT_STREAM);
+    }
+
+    // Sends `data` as one event to every subscriber. In DeliveryMode::LATEST a slow client
+    // skips straight to the newest event. `data` must be a single line, e.g. compact JSON.
+    void publishEvent(const nadjieb::net::TopicHandle& topic, std::string_view data) {
+        publisher_.enqueue(topic, nadjieb::net::makeEvent(data));
+    }
 
     void setShutdownTarget(const std::string& target) { shutdown_target_ = target; }
 
+    // Path serving getMetrics() in the Prometheus text format; empty turns the endpoint off.
+    void setMetricsTarget(const std::string& target) { metrics_target_ = target; }
+
+    // Holds the streamer's own metrics. Applications may add theirs to be served alongside.
+    nadjieb::utils::MetricsRegistry& getMetrics() { return metrics_; }
+
+    // Serves `method path` with `handler` on the listener thread, so handlers must be quick.
+    // Routes are matched on the path without the query and must be added before start().
+    void addRoute(const std::string& method, const std::string& path, RouteHandler handler) {
+        routes_[method + " " + path] = std::move(handler);
+    }
+
+    void setDeliveryMode(nadjieb::net::DeliveryMode mode) { publisher_.setDeliveryMode(mode); }
+
+    void setListenerEngine(nadjieb::net::ListenerEngine engine) { listener_engine_ = engine; }
+
+    nadjieb::net::PublisherStats getStats() const { return publisher_.getStats(); }
+
     bool isRunning() { return (publisher_.isRunning() && listener_.isRunning()); }
 
+    // Port the streamer listens on, e.g. the one picked by start(0)
+    int getPort() const { return listener_.getPort(); }
+
     bool hasClient(const std::string& path) { return publisher_.hasClient(path); }
 
+    bool hasClient(const nadjieb::net::TopicHandle& topic) { return publisher_.hasClient(topic); }
+
+    // True if `<topic>/snapshot.jpg` was requested within `window`. A producer that only
+    // encodes while watched should treat this as a viewer, or pollers get a stale frame.
+    bool hasSnapshotDemand(const nadjieb::net::TopicHandle& topic, std::chrono::steady_clock::duration window) const {
+        return topic->hasSnapshotDemand(window);
+    }
+
    private:
     nadjieb::net::Listener listener_;
     nadjieb::net::Publisher publisher_;
     std::string shutdown_target_ = "/shutdown";
+    std::string metrics_target_ = "/metrics";
+    nadjieb::utils::MetricsRegistry metrics_;
+    std::unordered_map<std::string, RouteHandler> routes_;
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+    nadjieb::net::ListenerEngine listener_engine_ = nadjieb::net::ListenerEngine::EPOLL;
+#else
+    nadjieb::net::ListenerEngine listener_engine_ = nadjieb::net::ListenerEngine::POLL;
+#endif
+
+    nadjieb::net::ResponseCache responses_;
+    size_t shutdown_res_;
+    size_t method_not_allowed_res_;
+    size_t not_found_res_;
+    size_t bad_request_res_;
+    size_t unavailable_res_;
+    size_t stream_init_res_;
+    size_t event_init_res_;
+
+    void buildResponses() {
+        nadjieb::net::HTTPResponse shutdown_res;
+        shutdown_res.setStatusCode(200);
+        shutdown_res.setStatusText("OK");
+        shutdown_res_ = responses_.add(shutdown_res);
+
+        nadjieb::net::HTTPResponse method_not_allowed_res;
+        method_not_allowed_res.setStatusCode(405);
+        method_not_allowed_res.setStatusText("Method Not Allowed");
+        method_not_allowed_res_ = responses_.add(method_not_allowed_res);
+
+        nadjieb::net::HTTPResponse not_found_res;
+        not_found_res.setStatusCode(404);
+        not_found_res.setStatusText("Not Found");
+        not_found_res_ = responses_.add(not_found_res);
+
+        nadjieb::net::HTTPResponse bad_request_res;
+        bad_request_res.setStatusCode(400);
+        bad_request_res.setStatusText("Bad Request");
+        bad_request_res_ = responses_.add(bad_request_res);
+
+        nadjieb::net::HTTPResponse unavailable_res;
+        unavailable_res.setStatusCode(503);
+        unavailable_res.setStatusText("Service Unavailable");
+        unavailable_res.setValue("Retry-After", "1");
+        unavailable_res_ = responses_.add(unavailable_res);
+
+        nadjieb::net::HTTPResponse init_res;
+        init_res.setStatusCode(200);
+        init_res.setStatusText("OK");
+        init_res.setValue("Connection", "close");
+        init_res.setValue("Cache-Control", "no-cache, no-store, must-revalidate, pre-check=0, post-check=0, max-age=0");
+        init_res.setValue("Pragma", "no-cache");
+        init_res.setValue("Content-Type", "multipart/x-mixed-replace; boundary=nadjiebmjpegstreamer");
+        stream_init_res_ = responses_.add(init_res);
+
+        nadjieb::net::HTTPResponse event_init_res;
+        event_init_res.setStatusCode(200);
+        event_init_res.setStatusText("OK");
+        event_init_res.setValue("Connection", "close");
+        event_init_res.setValue("Cache-Control", "no-cache");
+        event_init_res.setValue("Content-Type", "text/event-stream");
+        event_init_res.setValue("Access-Control-Allow-Origin", "*");
+        event_init_res_ = responses_.add(event_init_res);
+    }
+
+    void registerMetrics() {
+        using Type = nadjieb::utils::MetricsRegistry::Type;
+        using Sample = nadjieb::utils::MetricsRegistry::Sample;
+
+        metrics_.add(
+            "nadjieb_connections_accepted_total", "Connections accepted by the listener.",
+            &listener_.getConnectionsAccepted());
+        metrics_.add("nadjieb_connections_open", "Connections currently open.", &listener_.getConnectionsOpen());
+        metrics_.add("nadjieb_frames_sent_total", "Frames written completely to a client.", &publisher_.getFramesSent());
+        metrics_.add(
+            "nadjieb_frames_deferred_total", "Frames that waited for a full socket to drain.",
+            &publisher_.getFramesDeferred());
+        metrics_.add(
+            "nadjieb_frames_dropped_total", "Frames a client never received.", &publisher_.getFramesDropped());
+        metrics_.add(
+            "nadjieb_frames_paced_total", "Frames withheld to honour a client's fps.", &publisher_.getFramesPaced());
+        metrics_.add(
+            "nadjieb_frame_send_latency_seconds", "Time from sealing a frame to the client's socket accepting all of it.",
+            &publisher_.getSendLatency());
+
+        metrics_.addCollector(
+            "nadjieb_clients_waiting", "Clients blocked on a full socket.", Type::GAUGE,
+            [this](std::vector<Sample>& samples) {
+                samples.push_back(Sample{"", (double)publisher_.getStats().clients_waiting});
+            });
+
+        auto per_topic = [this](nadjieb::utils::Counter nadjieb::net::DeliveryMetrics::*counter) {
+            return [this, counter](std::vector<Sample>& samples) {
+                for (const auto& topic : publisher_.getTopics()) {
+                    samples.push_back(Sample{
+                        nadjieb::utils::MetricsRegistry::label("topic", topic->getPath()),
+                        (double)(topic->getMetrics().*counter).value()});
+                }
+            };
+        };
+        metrics_.addCollector(
+            "nadjieb_topic_frames_published_total", "Frames published to a topic.", Type::COUNTER,
+            per_topic(&nadjieb::net::DeliveryMetrics::frames_published));
+        metrics_.addCollector(
+            "nadjieb_topic_frames_sent_total", "Frames of a topic written completely to a client.", Type::COUNTER,
+            per_topic(&nadjieb::net::DeliveryMetrics::frames_sent));
+        metrics_.addCollector(
+            "nadjieb_topic_frames_dropped_total", "Frames of a topic a client never received.", Type::COUNTER,
+            per_topic(&nadjieb::net::DeliveryMetrics::frames_dropped));
+
+        metrics_.addCollector(
+            "nadjieb_topic_clients", "Clients subscribed to a topic.", Type::GAUGE,
+            [this](std::vector<Sample>& samples) {
+                for (const auto& topic : publisher_.getTopics()) {
+                    samples.push_back(Sample{
+                        nadjieb::utils::MetricsRegistry::label("topic", topic->getPath()),
+                        (double)topic->getClients()->clients.size()});
+                }
+            });
+
+        metrics_.addCollector(
+            "nadjieb_topic_clients_waiting", "Clients of a topic blocked on a full socket.", Type::GAUGE,
+            [this](std::vector<Sample>& samples) {
+                for (const auto& topic : publisher_.getTopics()) {
+                    samples.push_back(Sample{
+                        nadjieb::utils::MetricsRegistry::label("topic", topic->getPath()),
+                        (double)topic->getMetrics().clients_waiting.value()});
+                }
+            });
+
+        // Frames scheduled for a client but not yet taken by its shard, plus one while a
+        // partially written frame waits for the socket.
+        metrics_.addCollector(
+            "nadjieb_client_queue_depth", "Frames waiting to be written to a client.", Type::GAUGE,
+            [this](std::vector<Sample>& samples) {
+                for (const auto& topic : publisher_.getTopics()) {
+                    auto topic_label = nadjieb::utils::MetricsRegistry::label("topic", topic->getPath());
+                    for (const auto& client : topic->getClients()->clients) {
+                        samples.push_back(Sample{
+                            topic_label + "," + nadjieb::utils::MetricsRegistry::label(
+                                "client", std::to_string(client->getSocket())),
+                            (double)(client->getQueueSize() + (client->isWaitingWritable() ? 1 : 0))});
+                    }
+                }
+            });
+    }
+
+    void sendResponse(const nadjieb::net::SocketFD& sockfd, size_t id, std::string_view version) {
+        std::string scratch;
+        auto res_str = responses_.get(id, version, scratch);
+
+        nadjieb::net::sendViaSocket(sockfd, res_str.data(), res_str.size(), 0);
+    }
+
+    // Reads `fps` and `maxlag` (milliseconds) from the query string, e.g. a background
+    // preview asking for /video_feed?fps=2. Returns false if either is not a positive integer.
+    static bool parseClientOptions(const nadjieb::net::HTTPRequest& req, nadjieb::net::ClientOptions& options) {
+        unsigned int value = 0;
+
+        auto fps = req.getQueryValue("fps");
+        if (!fps.empty()) {
+            if (!parseUnsigned(fps, value) || value == 0) {
+                return false;
+            }
+            options.min_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::seconds(1)) / value;
+        }
+
+        auto max_lag = req.getQueryValue("maxlag");
+        if (!max_lag.empty()) {
+            if (!parseUnsigned(max_lag, value) || value == 0) {
+                return false;
+            }
+            options.max_lag = std::chrono::milliseconds(value);
+        }
+
+        return true;
+    }
+
+    // Serves `<topic>/snapshot.jpg`: the topic's latest frame as a single JPEG, straight
+    // from the buffer already encoded for the stream. The ETag is the frame's sequence
+    // number, so a poller that already has it gets a 304 and no body. Last-Modified is when
+    // the frame was sealed, so a poller can tell a stale frame.
+    void sendSnapshot(const nadjieb::net::SocketFD& sockfd, const nadjieb::net::HTTPRequest& req,
+                      const nadjieb::net::TopicHandle& topic, nadjieb::net::OnMessageCallbackResponse& cb_res) {
+        topic->noteSnapshotRequest();
+        auto frame = topic->getFrame();
+        if (!frame) {
+            sendResponse(sockfd, unavailable_res_, req.getVersion());
+            cb_res.close_conn = true;
+            return;
+        }
+
+        auto etag = "\"" + std::to_string(frame->getSequence()) + "\"";
+
+        nadjieb::net::HTTPResponse res;
+        res.setVersion(std::string(req.getVersion()));
+        res.setValue("Connection", "close");
+        res.setValue("Cache-Control", "no-cache");
+        res.setValue("ETag", etag);
+        res.setValue("Last-Modified", httpDate(frame->getSealedAt()));
+
+        if (matchesETag(req.getValue("If-None-Match"), etag)) {
+            res.setStatusCode(304);
+            res.setStatusText("Not Modified");
+
+            auto res_str = res.serialize();
+            nadjieb::net::sendViaSocket(sockfd, res_str.data(), res_str.size(), 0);
+            cb_res.close_conn = true;
+            return;
+        }
+
+        res.setStatusCode(200);
+        res.setStatusText("OK");
+        res.setValue("Content-Type", "image/jpeg");
+        res.setContentLength(frame->getPayload().size());
+
+        if (!publisher_.addSnapshot(sockfd, res.serialize(), std::move(frame))) {
+            sendResponse(sockfd, unavailable_res_, req.getVersion()); // Shutting down
+            cb_res.close_conn = true;
+        }
+    }
+
+    // IMF-fixdate of a steady_clock instant, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    static std::string httpDate(std::chrono::steady_clock::time_point at) {
+        auto wall = std::chrono::system_clock::now()
+                    - std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::steady_clock::now() - at);
+        std::time_t t = std::chrono::system_clock::to_time_t(wall);
+        std::tm tm;
+        gmtime_r(&t, &tm);
+
+        char date[32];
+        size_t len = std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(date, len);
+    }
+
+    // If-None-Match holds `*` or a comma-separated list of tags, possibly weak (W/"...").
+    static bool matchesETag(std::string_view header, std::string_view etag) {
+        while (!header.empty()) {
+            auto end = header.find(',');
+            auto tag = header.substr(0, end);
+            header = (end == std::string_view::npos) ? std::string_view() : header.substr(end + 1);
+
+            while (!tag.empty() && tag.front() == ' ') {
+                tag.remove_prefix(1);
+            }
+            while (!tag.empty() && tag.back() == ' ') {
+                tag.remove_suffix(1);
+            }
+            if (tag.substr(0, 2) == "W/") {
+                tag.remove_prefix(2);
+            }
+
+            if (tag == "*" || tag == etag) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void sendRouteResponse(
+        const nadjieb::net::SocketFD& sockfd, std::string_view version, const RouteResponse& route_res) {
+        nadjieb::net::HTTPResponse res;
+        res.setVersion(std::string(version));
+        res.setStatusCode(route_res.status_code);
+        res.setStatusText(route_res.status_text);
+        res.setValue("Connection", "close");
+        res.setValue("Content-Type", route_res.content_type);
+        res.setContentLength(route_res.body.size());
+        res.setBody(route_res.body);
+
+        auto res_str = res.serialize();
+        nadjieb::net::sendViaSocket(sockfd, res_str.data(), res_str.size(), 0);
+    }
+
+    static bool parseUnsigned(std::string_view str, unsigned int& value) {
+        auto res = std::from_chars(str.data(), str.data() + str.size(), value);
+        return (res.ec == std::errc() && res.ptr == str.data() + str.size());
+    }
 
     nadjieb::net::OnMessageCallback on_message_cb_ = [&](const nadjieb::net::SocketFD& sockfd,
-                                                         const std::string& message) {
-        nadjieb::net::HTTPRequest req(message);
+                                                         const nadjieb::net::HTTPRequest& req) {
         nadjieb::net::OnMessageCallbackResponse cb_res;
+        std::string target(req.getTarget());
 
-        if (req.getTarget() == shutdown_target_) {
-            nadjieb::net::HTTPResponse shutdown_res;
-            shutdown_res.setVersion(req.getVersion());
-            shutdown_res.setStatusCode(200);
-            shutdown_res.setStatusText("OK");
-            auto shutdown_res_str = shutdown_res.serialize();
-
-            nadjieb::net::sendViaSocket(sockfd, shutdown_res_str.c_str(), shutdown_res_str.size(), 0);
+        if (target == shutdown_target_) {
+            sendResponse(sockfd, shutdown_res_, req.getVersion());
 
             publisher_.stop();
 
@@ -90,46 +452,70 @@ class MJPEGStreamer : public nadjieb::utils::NonCopyable {
             return cb_res;
         }
 
-        if (req.getMethod() != "GET") {
-            nadjieb::net::HTTPResponse method_not_allowed_res;
-            method_not_allowed_res.setVersion(req.getVersion());
-            method_not_allowed_res.setStatusCode(405);
-            method_not_allowed_res.setStatusText("Method Not Allowed");
-            auto method_not_allowed_res_str = method_not_allowed_res.serialize();
+        if (!metrics_target_.empty() && req.getMethod() == "GET" && req.getPath() == metrics_target_) {
+            RouteResponse metrics_res;
+            metrics_res.content_type = "text/plain; version=0.0.4; charset=utf-8";
+            metrics_res.body = metrics_.render();
+            sendRouteResponse(sockfd, req.getVersion(), metrics_res);
+
+            cb_res.close_conn = true;
+            return cb_res;
+        }
+
+        if (!routes_.empty()) {
+            std::string route_key(req.getMethod());
+            route_key.append(" ").append(req.getPath());
 
-            nadjieb::net::sendViaSocket(
-                sockfd, method_not_allowed_res_str.c_str(), method_not_allowed_res_str.size(), 0);
+            auto route = routes_.find(route_key);
+            if (route != routes_.end()) {
+                sendRouteResponse(sockfd, req.getVersion(), route->second(req));
+
+                cb_res.close_conn = true;
+                return cb_res;
+            }
+        }
+
+        if (req.getMethod() != "GET") {
+            sendResponse(sockfd, method_not_allowed_res_, req.getVersion());
 
             cb_res.close_conn = true;
             return cb_res;
         }
 
-        if (!publisher_.pathExists(req.getTarget())) {
-            nadjieb::net::HTTPResponse not_found_res;
-            not_found_res.setVersion(req.getVersion());
-            not_found_res.setStatusCode(404);
-            not_found_res.setStatusText("Not Found");
-            auto not_found_res_str = not_found_res.serialize();
+        // Topics are matched on the path alone; the query only carries client options.
+        std::string path(req.getPath());
+
+        auto topic = publisher_.findTopic(path);
+
+        static const std::string SNAPSHOT_SUFFIX = "/snapshot.jpg";
+        if (!topic && path.size() > SNAPSHOT_SUFFIX.size()
+            && path.compare(path.size() - SNAPSHOT_SUFFIX.size(), SNAPSHOT_SUFFIX.size(), SNAPSHOT_SUFFIX) == 0) {
+            auto snapshot_topic = publisher_.findTopic(path.substr(0, path.size() - SNAPSHOT_SUFFIX.size()));
+            if (snapshot_topic && snapshot_topic->getType() == nadjieb::net::TopicType::MJPEG) {
+                sendSnapshot(sockfd, req, snapshot_topic, cb_res);
+                return cb_res;
+            }
+        }
 
-            nadjieb::net::sendViaSocket(sockfd, not_found_res_str.c_str(), not_found_res_str.size(), 0);
+        if (!topic) {
+            sendResponse(sockfd, not_found_res_, req.getVersion());
 
             cb_res.close_conn = true;
             return cb_res;
         }
 
-        nadjieb::net::HTTPResponse init_res;
-        init_res.setVersion(req.getVersion());
-        init_res.setStatusCode(200);
-        init_res.setStatusText("OK");
-        init_res.setValue("Connection", "close");
-        init_res.setValue("Cache-Control", "no-cache, no-store, must-revalidate, pre-check=0, post-check=0, max-age=0");
-        init_res.setValue("Pragma", "no-cache");
-        init_res.setValue("Content-Type", "multipart/x-mixed-replace; boundary=nadjiebmjpegstreamer");
-        auto init_res_str = init_res.serialize();
+        nadjieb::net::ClientOptions options;
+        if (!parseClientOptions(req, options)) {
+            sendResponse(sockfd, bad_request_res_, req.getVersion());
+
+            cb_res.close_conn = true;
+            return cb_res;
+        }
 
-        nadjieb::net::sendViaSocket(sockfd, init_res_str.c_str(), init_res_str.size(), 0);
+        auto init_res = (topic->getType() == nadjieb::net::TopicType::EVENT_STREAM) ? event_init_res_ : stream_init_res_;
+        sendResponse(sockfd, init_res, req.getVersion());
 
-        publisher_.add(sockfd, req.getTarget());
+        publisher_.add(sockfd, path, options);
 
         return cb_res;
     };
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <nadjieb/net/frame.hpp>
+#include <nadjieb/net/socket.hpp>
+#include <nadjieb/utils/metrics.hpp>
+#include <nadjieb/utils/non_copyable.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace nadjieb {
+namespace net {
+enum class SendStatus { DONE, WOULD_BLOCK, FAILED };
+
+// Delivery limits a viewer asked for. Zero leaves the limit off.
+struct ClientOptions {
+    // Minimum time between frames offered to the client, i.e. 1 / fps.
+    std::chrono::steady_clock::duration min_interval{0};
+    // Frames older than this when their turn to be sent comes are dropped instead.
+    std::chrono::steady_clock::duration max_lag{0};
+};
+
+// Delivery counters of one topic, shared by the topic and its clients so a shard can count
+// per topic without knowing which topic a client belongs to.
+struct DeliveryMetrics {
+    nadjieb::utils::Counter frames_published;
+    nadjieb::utils::Counter frames_sent;
+    nadjieb::utils::Counter frames_dropped;
+    // Clients of the topic currently blocked on a full socket.
+    nadjieb::utils::Gauge clients_waiting;
+};
+
+// Write state of one streaming connection, only ever touched by the publisher shard it is
+// pinned to. A frame that the socket only partially accepted stays here with its offset
+// until the rest can be sent.
+class Client : public nadjieb::utils::NonCopyable {
+   public:
+    Client(SocketFD sockfd, size_t shard, DeliveryMetrics& metrics, const ClientOptions& options = ClientOptions())
+        : sockfd_(sockfd), shard_(shard), metrics_(metrics), options_(options) {}
+
+    SocketFD getSocket() const { return sockfd_; }
+
+    size_t getShard() const { return shard_; }
+
+    DeliveryMetrics& getMetrics() const { return metrics_; }
+
+    const ClientOptions& getOptions() const { return options_; }
+
+    // Turns the client into a single response: `head` replaces the multipart part header,
+    // and the connection is finished after one frame.
+    void setSnapshot(std::string head) { snapshot_head_ = std::move(head); }
+
+    bool isSnapshot() const { return !snapshot_head_.empty(); }
+
+    // Paces the client to options.min_interval. Due times advance by whole intervals, so a
+    // source faster than the requested rate still averages out at that rate.
+    bool isDue(std::chrono::steady_clock::time_point now) {
+        if (options_.min_interval.count() == 0) {
+            return true;
+        }
+
+        auto next_due = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(next_due_.load()));
+        if (now < next_due) {
+            return false;
+        }
+
+        next_due_ = std::max(next_due + options_.min_interval, now).time_since_epoch().count();
+        return true;
+    }
+
+    // True if `frame` waited longer than options.max_lag since it was sealed.
+    bool isStale(const Frame& frame) const {
+        return options_.max_lag.count() != 0
+               && std::chrono::steady_clock::now() - frame.getSealedAt() > options_.max_lag;
+    }
+
+    // Latest-frame-wins delivery slot. A newer frame replaces one that has not been picked
+    // up yet. Returns true if the caller must schedule the client for sending.
+    // `replaced` reports whether an unsent frame was overwritten.
+    bool offerFrame(FramePtr frame, bool& replaced) {
+        std::unique_lock<std::mutex> lock(slot_mtx_);
+        replaced = (slot_frame_ != nullptr);
+        slot_frame_ = std::move(frame);
+        lock.unlock();
+
+        return !scheduled_.exchange(true);
+    }
+
+    // Clears the scheduled flag before emptying the slot, so a frame offered after this
+    // call schedules the client again instead of being stranded.
+    FramePtr takeFrame() {
+        scheduled_ = false;
+
+        std::unique_lock<std::mutex> lock(slot_mtx_);
+        return std::move(slot_frame_);
+    }
+
+    // Frames scheduled in DeliveryMode::QUEUE but not yet taken by the shard.
+    int getQueueSize() const { return queue_size_; }
+
+    void increaseQueue() { ++queue_size_; }
+
+    void decreaseQueue() { --queue_size_; }
+
+    // Held while writing so the listener cannot close and reuse the descriptor mid-send.
+    std::mutex& getCloseMutex() { return close_mtx_; }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(close_mtx_);
+        closed_ = true;
+    }
+
+    bool isClosed() const { return closed_; }
+
+    // Set by the owning shard: the client has a partial frame and waits for the socket to
+    // drain. Atomic only so metrics can read it from another thread.
+    bool isWaitingWritable() const { return waiting_writable_; }
+
+    void setWaitingWritable(bool waiting) { waiting_writable_ = waiting; }
+
+    // Shard-owned state: the descriptor has been added to the shard's epoll set.
+    bool isRegistered() const { return registered_; }
+
+    void setRegistered(bool registered) { registered_ = registered; }
+
+    bool hasPendingWrite() const { return (pending_frame_ != nullptr); }
+
+    // The frame being written, valid until the write finishes.
+    const Frame* getPendingFrame() const { return pending_frame_.get(); }
+
+    void startWrite(FramePtr frame) {
+        pending_frame_ = std::move(frame);
+        offset_ = 0;
+        pending_size_ = 0;
+        if (pending_frame_) {
+            pending_size_ = isSnapshot() ? snapshot_head_.size() + pending_frame_->getPayload().size()
+                                         : pending_frame_->size();
+        }
+    }
+
+    SendStatus flush() {
+        while (pending_frame_) {
+            SocketBuffer buffers[NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS];
+            auto count = getBuffers(buffers);
+
+            auto sent = sendBuffersViaSocket(sockfd_, buffers, count);
+            if (sent == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR) {
+                if (NADJIEB_MJPEG_STREAMER_ERRNO == NADJIEB_MJPEG_STREAMER_EWOULDBLOCK) {
+                    return SendStatus::WOULD_BLOCK;
+                }
+
+                startWrite(nullptr);
+                return SendStatus::FAILED;
+            }
+
+            offset_ += (size_t)sent;
+            if (offset_ >= pending_size_) {
+                startWrite(nullptr);
+            }
+        }
+
+        return SendStatus::DONE;
+    }
+
+   private:
+    SocketFD sockfd_;
+    size_t shard_;
+    DeliveryMetrics& metrics_;
+    ClientOptions options_;
+    std::atomic<int64_t> next_due_{0};
+    std::mutex slot_mtx_;
+    FramePtr slot_frame_;
+    std::atomic<bool> scheduled_{false};
+    std::atomic<int> queue_size_{0};
+    std::mutex close_mtx_;
+    std::atomic<bool> closed_{false};
+    std::atomic<bool> waiting_writable_{false};
+    bool registered_ = false;
+    std::string snapshot_head_;
+    FramePtr pending_frame_;
+    size_t pending_size_ = 0;
+    size_t offset_ = 0;
+
+    size_t getBuffers(SocketBuffer* buffers) const {
+        if (!isSnapshot()) {
+            return pending_frame_->getBuffers(offset_, buffers);
+        }
+
+        auto payload = pending_frame_->getPayload();
+        auto offset = offset_;
+
+        size_t count = 0;
+        if (offset < snapshot_head_.size()) {
+            buffers[count++] = SocketBuffer{snapshot_head_.data() + offset, snapshot_head_.size() - offset};
+            offset = 0;
+        } else {
+            offset -= snapshot_head_.size();
+        }
+
+        if (offset < payload.size()) {
+            buffers[count++] = SocketBuffer{payload.data() + offset, payload.size() - offset};
+        }
+
+        return count;
+    }
+};
+}  // namespace net
+}  // namespace nadjieb
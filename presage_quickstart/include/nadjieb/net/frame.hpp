@@ -0,0 +1,132 @@
+#pragma once
+
+#include <nadjieb/net/socket.hpp>
+#include <nadjieb/utils/non_copyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace nadjieb {
+namespace net {
+// Encoded frame. Published once and shared by reference between the topic and every
+// client it is sent to, so the payload is never copied after encode. The payload buffer
+// is filled in place and then sealed, which serializes the framing around it (a multipart
+// part header, or a server-sent event line) once instead of once per client. A sealed
+// frame must not be modified while it is shared.
+// Sealing also stamps the frame with the time, so delivery can tell how long it has been
+// waiting, and with a process-wide sequence number that identifies its content.
+class Frame : public nadjieb::utils::NonCopyable {
+   public:
+    Frame() = default;
+
+    explicit Frame(std::string_view payload) : payload_(payload.begin(), payload.end()) { seal(); }
+
+    // Buffer to encode into. Its capacity is kept across reuse.
+    std::vector<unsigned char>& getBuffer() { return payload_; }
+
+    void seal() {
+        static constexpr std::string_view PREFIX
+            = "--nadjiebmjpegstreamer\r\n"
+              "Content-Type: image/jpeg\r\n"
+              "Content-Length: ";
+
+        char* out = header_.data();
+        std::memcpy(out, PREFIX.data(), PREFIX.size());
+        out = std::to_chars(out + PREFIX.size(), header_.data() + header_.size(), payload_.size()).ptr;
+        std::memcpy(out, "\r\n\r\n", 4);
+        header_size_ = (out + 4) - header_.data();
+        trailer_ = std::string_view();
+        stamp();
+    }
+
+    // Frames the payload as one server-sent event. The payload must not contain newlines.
+    void sealEvent() {
+        static constexpr std::string_view PREFIX = "data: ";
+
+        std::memcpy(header_.data(), PREFIX.data(), PREFIX.size());
+        header_size_ = PREFIX.size();
+        trailer_ = "\n\n";
+        stamp();
+    }
+
+    std::chrono::steady_clock::time_point getSealedAt() const { return sealed_at_; }
+
+    uint64_t getSequence() const { return sequence_; }
+
+    std::string_view getHeader() const { return std::string_view(header_.data(), header_size_); }
+
+    std::string_view getPayload() const {
+        return std::string_view(reinterpret_cast<const char*>(payload_.data()), payload_.size());
+    }
+
+    std::string_view getTrailer() const { return trailer_; }
+
+    size_t size() const { return header_size_ + payload_.size() + trailer_.size(); }
+
+    // Fills `buffers` with the bytes remaining after `offset` and returns how many were used.
+    size_t getBuffers(size_t offset, SocketBuffer* buffers) const {
+        auto header = getHeader();
+        auto payload = getPayload();
+
+        size_t count = 0;
+        if (offset < header.size()) {
+            buffers[count++] = SocketBuffer{header.data() + offset, header.size() - offset};
+            offset = 0;
+        } else {
+            offset -= header.size();
+        }
+
+        if (offset < payload.size()) {
+            buffers[count++] = SocketBuffer{payload.data() + offset, payload.size() - offset};
+            offset = 0;
+        } else {
+            offset -= payload.size();
+        }
+
+        if (offset < trailer_.size()) {
+            buffers[count++] = SocketBuffer{trailer_.data() + offset, trailer_.size() - offset};
+        }
+
+        return count;
+    }
+
+   private:
+    std::array<char, 96> header_;
+    size_t header_size_ = 0;
+    std::string_view trailer_;
+    std::chrono::steady_clock::time_point sealed_at_;
+    uint64_t sequence_ = 0;
+    std::vector<unsigned char> payload_;
+
+    void stamp() {
+        sealed_at_ = std::chrono::steady_clock::now();
+        sequence_ = nextSequence();
+    }
+
+    static uint64_t nextSequence() {
+        static std::atomic<uint64_t> sequence{0};
+        return ++sequence;
+    }
+};
+
+typedef std::shared_ptr<const Frame> FramePtr;
+
+inline FramePtr makeFrame(std::string_view payload) {
+    return std::make_shared<const Frame>(payload);
+}
+
+inline FramePtr makeEvent(std::string_view data) {
+    auto frame = std::make_shared<Frame>();
+    frame->getBuffer().assign(data.begin(), data.end());
+    frame->sealEvent();
+    return frame;
+}
+}  // namespace net
+}  // namespace nadjieb
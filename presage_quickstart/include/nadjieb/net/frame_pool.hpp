@@ -0,0 +1,61 @@
+#pragma once
+
+#include <nadjieb/net/frame.hpp>
+#include <nadjieb/utils/non_copyable.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace nadjieb {
+namespace net {
+// Recycles frames and their encode buffers for a single producer. A frame is free again
+// once the pool holds the only reference, i.e. the topic and every client are done with
+// it, so after warm-up publishing reuses the same few buffers instead of allocating.
+class FramePool : public nadjieb::utils::NonCopyable {
+   public:
+    explicit FramePool(size_t capacity = 8, size_t reserve_bytes = 0)
+        : capacity_(capacity), reserve_bytes_(reserve_bytes) {
+        frames_.reserve(capacity_);
+    }
+
+    // Allocates every pooled frame and its buffer up front. The pool otherwise grows on demand,
+    // so a new peak of frames in flight can still allocate long after warm-up.
+    void prefill() {
+        while (frames_.size() < capacity_) {
+            auto frame = std::make_shared<Frame>();
+            frame->getBuffer().reserve(reserve_bytes_);
+            frames_.push_back(std::move(frame));
+        }
+    }
+
+    // Returns a frame the caller may fill through getBuffer() and then seal(). When every
+    // pooled frame is still in flight, an unpooled frame is returned instead.
+    std::shared_ptr<Frame> acquire() {
+        for (size_t i = 0; i < frames_.size(); ++i) {
+            auto& frame = frames_[(next_ + i) % frames_.size()];
+            if (frame.use_count() == 1) {
+                // Pairs with the release of the last reference by another thread.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                next_ = (next_ + i + 1) % frames_.size();
+                return frame;
+            }
+        }
+
+        auto frame = std::make_shared<Frame>();
+        frame->getBuffer().reserve(reserve_bytes_);
+        if (frames_.size() < capacity_) {
+            frames_.push_back(frame);
+        }
+
+        return frame;
+    }
+
+   private:
+    size_t capacity_;
+    size_t reserve_bytes_;
+    size_t next_ = 0;
+    std::vector<std::shared_ptr<Frame>> frames_;
+};
+}  // namespace net
+}  // namespace nadjieb
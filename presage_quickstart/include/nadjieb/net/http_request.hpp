@@ -1,62 +1,244 @@
 #pragma once
 
-#include <sstream>
+#include <array>
+#include <charconv>
+#include <cstring>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 // Reference https://developer.mozilla.org/en-US/docs/Web/HTTP/Messages#http_requests
 
 namespace nadjieb {
 namespace net {
+// Incremental request parser. Bytes are appended into a fixed per-connection buffer as
+// they arrive, and every accessor returns a view into that buffer, so parsing a request
+// never allocates. The views stay valid until reset() or the object is destroyed.
 class HTTPRequest {
    public:
-    HTTPRequest(const std::string& message) { parse(message); }
+    static const size_t MAX_HEADER_SIZE = 8192;
+    static const size_t MAX_BODY_SIZE = 8192;
+    static const size_t MAX_HEADERS = 32;
 
-    void parse(const std::string& message) {
-        std::istringstream iss(message);
+    enum class ParseStatus { INCOMPLETE, COMPLETE, BAD_REQUEST, HEADER_TOO_LARGE, BODY_TOO_LARGE };
 
-        std::getline(iss, method_, ' ');
-        std::getline(iss, target_, ' ');
-        std::getline(iss, version_, '\r');
+    HTTPRequest() = default;
 
-        std::string line;
-        std::getline(iss, line);
+    explicit HTTPRequest(const std::string& message) { parse(message.data(), message.size()); }
 
-        while (true) {
-            std::getline(iss, line);
-            if (line == "\r") {
-                break;
+    // Views point into buffer_, so copies would dangle.
+    HTTPRequest(const HTTPRequest&) = delete;
+    HTTPRequest& operator=(const HTTPRequest&) = delete;
+
+    // Appends `size` bytes and parses as far as the data allows. Once a terminal status is
+    // reached, further bytes are ignored and the same status is returned.
+    ParseStatus parse(const char* data, size_t size) {
+        if (status_ != ParseStatus::INCOMPLETE) {
+            return status_;
+        }
+
+        if (size > buffer_.size() - size_) {
+            return fail(header_size_ == 0 ? ParseStatus::HEADER_TOO_LARGE : ParseStatus::BODY_TOO_LARGE);
+        }
+
+        std::memcpy(&buffer_[size_], data, size);
+        size_ += size;
+
+        if (header_size_ == 0) {
+            std::string_view received(buffer_.data(), size_);
+            auto end = received.find("\r\n\r\n", (scan_ > 3) ? scan_ - 3 : 0);
+            if (end == std::string_view::npos) {
+                scan_ = size_;
+                return (size_ > MAX_HEADER_SIZE) ? fail(ParseStatus::HEADER_TOO_LARGE) : status_;
             }
 
-            std::string key;
-            std::string value;
-            std::istringstream iss_header(line);
-            std::getline(iss_header, key, ':');
-            std::getline(iss_header, value, ' ');
-            std::getline(iss_header, value, '\r');
+            header_size_ = end + 4;
+            if (header_size_ > MAX_HEADER_SIZE) {
+                return fail(ParseStatus::HEADER_TOO_LARGE);
+            }
 
-            headers_[key] = value;
+            auto head_status = parseHead(received.substr(0, end));
+            if (head_status != ParseStatus::INCOMPLETE) {
+                return fail(head_status);
+            }
+
+            if (content_length_ > MAX_BODY_SIZE) {
+                return fail(ParseStatus::BODY_TOO_LARGE);
+            }
+        }
+
+        if (size_ - header_size_ >= content_length_) {
+            body_ = std::string_view(buffer_.data() + header_size_, content_length_);
+            status_ = ParseStatus::COMPLETE;
         }
 
-        body_ = iss.str().substr(iss.tellg());
+        return status_;
     }
 
-    const std::string& getMethod() const { return method_; }
+    void reset() {
+        size_ = 0;
+        scan_ = 0;
+        header_size_ = 0;
+        content_length_ = 0;
+        status_ = ParseStatus::INCOMPLETE;
+        method_ = target_ = path_ = query_ = version_ = body_ = std::string_view();
+        header_count_ = 0;
+    }
+
+    ParseStatus getStatus() const { return status_; }
+
+    std::string_view getMethod() const { return method_; }
 
-    const std::string& getTarget() const { return target_; }
+    // Request target as sent, including any query string.
+    std::string_view getTarget() const { return target_; }
 
-    const std::string& getVersion() const { return version_; }
+    std::string_view getPath() const { return path_; }
 
-    const std::string& getValue(const std::string& key) { return headers_[key]; }
+    std::string_view getQuery() const { return query_; }
 
-    const std::string& getBody() const { return body_; }
+    // Value of the first `key=value` pair in the query string, without percent-decoding.
+    // A key given without `=` yields an empty view, as does an absent one.
+    std::string_view getQueryValue(std::string_view key) const {
+        auto query = query_;
+        while (!query.empty()) {
+            auto end = query.find('&');
+            auto param = query.substr(0, end);
+            query = (end == std::string_view::npos) ? std::string_view() : query.substr(end + 1);
+
+            auto eq = param.find('=');
+            if (param.substr(0, eq) == key) {
+                return (eq == std::string_view::npos) ? std::string_view() : param.substr(eq + 1);
+            }
+        }
+
+        return std::string_view();
+    }
+
+    std::string_view getVersion() const { return version_; }
+
+    // Header names are matched case-insensitively. Returns an empty view if absent.
+    std::string_view getValue(std::string_view key) const {
+        for (size_t i = 0; i < header_count_; ++i) {
+            if (equalsIgnoreCase(headers_[i].first, key)) {
+                return headers_[i].second;
+            }
+        }
+
+        return std::string_view();
+    }
+
+    std::string_view getBody() const { return body_; }
 
    private:
-    std::string method_;
-    std::string target_;
-    std::string version_;
-    std::unordered_map<std::string, std::string> headers_;
-    std::string body_;
+    std::array<char, MAX_HEADER_SIZE + MAX_BODY_SIZE> buffer_;
+    size_t size_ = 0;
+    size_t scan_ = 0;
+    size_t header_size_ = 0;
+    size_t content_length_ = 0;
+    ParseStatus status_ = ParseStatus::INCOMPLETE;
+
+    std::string_view method_;
+    std::string_view target_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view version_;
+    std::array<std::pair<std::string_view, std::string_view>, MAX_HEADERS> headers_;
+    size_t header_count_ = 0;
+    std::string_view body_;
+
+    ParseStatus fail(ParseStatus status) {
+        status_ = status;
+        return status_;
+    }
+
+    // Returns INCOMPLETE once the head is parsed, since the body may still be arriving, or the
+    // reason the request is rejected.
+    ParseStatus parseHead(std::string_view head) {
+        auto line_end = head.find("\r\n");
+        auto line = head.substr(0, line_end);
+
+        auto method_end = line.find(' ');
+        if (method_end == std::string_view::npos || method_end == 0) {
+            return ParseStatus::BAD_REQUEST;
+        }
+        method_ = line.substr(0, method_end);
+
+        auto target_end = line.find(' ', method_end + 1);
+        if (target_end == std::string_view::npos || target_end == method_end + 1) {
+            return ParseStatus::BAD_REQUEST;
+        }
+        target_ = line.substr(method_end + 1, target_end - method_end - 1);
+        version_ = line.substr(target_end + 1);
+        if (version_.empty()) {
+            return ParseStatus::BAD_REQUEST;
+        }
+
+        auto query_start = target_.find('?');
+        path_ = target_.substr(0, query_start);
+        if (query_start != std::string_view::npos) {
+            query_ = target_.substr(query_start + 1);
+        }
+
+        while (line_end != std::string_view::npos) {
+            auto start = line_end + 2;
+            line_end = head.find("\r\n", start);
+            line = head.substr(start, (line_end == std::string_view::npos) ? line_end : line_end - start);
+
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos || colon == 0) {
+                return ParseStatus::BAD_REQUEST;
+            }
+
+            // Dropping the rest could lose Content-Length and mis-frame the body
+            if (header_count_ == MAX_HEADERS) {
+                return ParseStatus::HEADER_TOO_LARGE;
+            }
+
+            auto key = line.substr(0, colon);
+            auto value = trim(line.substr(colon + 1));
+            headers_[header_count_++] = std::make_pair(key, value);
+
+            if (equalsIgnoreCase(key, "Content-Length")) {
+                auto res = std::from_chars(value.data(), value.data() + value.size(), content_length_);
+                if (res.ec != std::errc() || res.ptr != value.data() + value.size()) {
+                    return ParseStatus::BAD_REQUEST;
+                }
+            }
+        }
+
+        return ParseStatus::INCOMPLETE;
+    }
+
+    static std::string_view trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    static bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            auto l = lhs[i];
+            auto r = rhs[i];
+            if (l >= 'A' && l <= 'Z') {
+                l = (char)(l - 'A' + 'a');
+            }
+            if (r >= 'A' && r <= 'Z') {
+                r = (char)(r - 'A' + 'a');
+            }
+            if (l != r) {
+                return false;
+            }
+        }
+
+        return true;
+    }
 };
 }  // namespace net
 }  // namespace nadjieb
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <sstream>
+#include <charconv>
+#include <cstring>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Reference https://developer.mozilla.org/en-US/docs/Web/HTTP/Messages#http_responses
 
@@ -10,33 +12,96 @@ namespace nadjieb {
 namespace net {
 class HTTPResponse {
    public:
-    std::string serialize() {
-        const std::string delimiter = "\r\n";
-        std::stringstream stream;
+    std::string serialize() const {
+        std::string res_str(size(), '\0');
+        serialize(&res_str[0], res_str.size());
+        return res_str;
+    }
+
+    // Writes the response into `buffer` if it fits and returns its size either way, so a
+    // return value larger than `capacity` means nothing was written. Numbers are formatted
+    // with to_chars straight into `buffer`, so this never allocates.
+    size_t serialize(char* buffer, size_t capacity) const {
+        auto res_size = size();
+        if (res_size > capacity) {
+            return res_size;
+        }
 
-        stream << version_ << ' ' << status_code_ << ' ' << status_text_ << delimiter;
+        char* out = buffer;
+        out = append(out, version_);
+        *out++ = ' ';
+        out = std::to_chars(out, buffer + capacity, status_code_).ptr;
+        *out++ = ' ';
+        out = append(out, status_text_);
+        out = append(out, DELIMITER);
 
         for (const auto& header : headers_) {
-            stream << header.first << ": " << header.second << delimiter;
+            out = append(out, header.first);
+            out = append(out, ": ");
+            out = append(out, header.second);
+            out = append(out, DELIMITER);
         }
 
-        stream << delimiter << body_;
+        out = append(out, DELIMITER);
+        append(out, body_);
+
+        return res_size;
+    }
+
+    size_t size() const {
+        char status_code[16];
+        auto status_code_size = std::to_chars(status_code, status_code + sizeof(status_code), status_code_).ptr - status_code;
 
-        return stream.str();
+        auto res_size = version_.size() + 1 + status_code_size + 1 + status_text_.size() + 2;
+        for (const auto& header : headers_) {
+            res_size += header.first.size() + 2 + header.second.size() + 2;
+        }
+
+        return res_size + 2 + body_.size();
     }
 
     void setVersion(const std::string& version) { version_ = version; }
     void setStatusCode(const int& status_code) { status_code_ = status_code; }
     void setStatusText(const std::string& status_text) { status_text_ = status_text; }
-    void setValue(const std::string& key, const std::string& value) { headers_[key] = value; }
     void setBody(const std::string& body) { body_ = body; }
 
+    void setContentLength(size_t length) {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), length).ptr;
+        setValue("Content-Length", std::string(digits, end));
+    }
+
+    // Headers are serialized in the order they were first set.
+    void setValue(const std::string& key, const std::string& value) {
+        for (auto& header : headers_) {
+            if (header.first == key) {
+                header.second = value;
+                return;
+            }
+        }
+
+        headers_.emplace_back(key, value);
+    }
+
    private:
+    static constexpr const char* DELIMITER = "\r\n";
+
     std::string version_;
     int status_code_;
     std::string status_text_;
-    std::unordered_map<std::string, std::string> headers_;
+    std::vector<std::pair<std::string, std::string>> headers_;
     std::string body_;
+
+    static char* append(char* out, const std::string& value) {
+        std::memcpy(out, value.data(), value.size());
+        return out + value.size();
+    }
+
+    static char* append(char* out, const char* value) {
+        auto length = std::strlen(value);
+        std::memcpy(out, value, length);
+        return out + length;
+    }
 };
 }  // namespace net
 }  // namespace nadjieb
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <nadjieb/net/http_request.hpp>
 #include <nadjieb/net/socket.hpp>
+#include <nadjieb/utils/metrics.hpp>
 #include <nadjieb/utils/non_copyable.hpp>
 #include <nadjieb/utils/runnable.hpp>
 
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace nadjieb {
@@ -18,9 +23,13 @@ struct OnMessageCallbackResponse {
     bool end_listener = false;
 };
 
-using OnMessageCallback = std::function<OnMessageCallbackResponse(const SocketFD&, const std::string&)>;
+using OnMessageCallback = std::function<OnMessageCallbackResponse(const SocketFD&, const HTTPRequest&)>;
 using OnBeforeCloseCallback = std::function<void(const SocketFD&)>;
 
+// POLL scans every connection on each wakeup and works everywhere. EPOLL is edge-triggered
+// and only touches the connections that are ready, so its cost does not grow with viewers.
+enum class ListenerEngine { POLL, EPOLL };
+
 class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runnable {
    public:
     virtual ~Listener() { stop(); }
@@ -35,6 +44,11 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
         return *this;
     }
 
+    Listener& withEngine(ListenerEngine engine) {
+        engine_ = engine;
+        return *this;
+    }
+
     void stop() {
         end_listener_ = true;
         if (thread_listener_.joinable()) {
@@ -42,12 +56,23 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
         }
     }
 
+    const nadjieb::utils::Counter& getConnectionsAccepted() const { return connections_accepted_; }
+
+    const nadjieb::utils::Gauge& getConnectionsOpen() const { return connections_open_; }
+
+    // Port the listener is bound to, so run(0) can be used to take any free port. Valid
+    // while running.
+    int getPort() const { return getSocketPort(listen_sd_); }
+
     void runAsync(int port) { thread_listener_ = std::thread(&Listener::run, this, port); }
 
     void run(int port) {
         state_ = nadjieb::utils::State::BOOTING;
         panicIfUnexpected(on_message_cb_ == nullptr, "not setting on_message_cb");
         panicIfUnexpected(on_before_close_cb_ == nullptr, "not setting on_before_close_cb");
+#ifndef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        panicIfUnexpected(engine_ == ListenerEngine::EPOLL, "epoll engine is only supported on Linux");
+#endif
 
         end_listener_ = false;
 
@@ -58,9 +83,51 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
         bindSocket(listen_sd_, "0.0.0.0", port);
         listenOnSocket(listen_sd_, SOMAXCONN);
 
-        fds_.emplace_back(NADJIEB_MJPEG_STREAMER_POLLFD{listen_sd_, POLLRDNORM, 0});
+        buff_.assign(4096, 0);
+
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        if (engine_ == ListenerEngine::EPOLL) {
+            runEpoll();
+        } else {
+            runPoll();
+        }
+#else
+        runPoll();
+#endif
+
+        closeAll();
+    }
+
+   private:
+    // Per-connection state, owned by the listener thread. The request is parsed as its
+    // bytes arrive and handed to the callback once; later bytes are ignored.
+    struct Connection {
+        explicit Connection(SocketFD fd) : sockfd(fd) {}
+
+        SocketFD sockfd;
+        HTTPRequest request;
+        bool dispatched = false;
+    };
+
+    SocketFD listen_sd_ = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
+    bool end_listener_ = true;
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+    ListenerEngine engine_ = ListenerEngine::EPOLL;
+    int epoll_fd_ = -1;
+#else
+    ListenerEngine engine_ = ListenerEngine::POLL;
+#endif
+    std::vector<NADJIEB_MJPEG_STREAMER_POLLFD> fds_;
+    std::unordered_map<SocketFD, std::unique_ptr<Connection>> connections_;
+    std::string buff_;
+    OnMessageCallback on_message_cb_;
+    OnBeforeCloseCallback on_before_close_cb_;
+    std::thread thread_listener_;
+    nadjieb::utils::Counter connections_accepted_;
+    nadjieb::utils::Gauge connections_open_;
 
-        std::string buff(4096, 0);
+    void runPoll() {
+        fds_.emplace_back(NADJIEB_MJPEG_STREAMER_POLLFD{listen_sd_, POLLRDNORM, 0});
 
         state_ = nadjieb::utils::State::RUNNING;
 
@@ -81,8 +148,7 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
                 }
 
                 if (fds_[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-                    on_before_close_cb_(fds_[i].fd);
-                    closeSocket(fds_[i].fd);
+                    closeConnection(fds_[i].fd);
                     fds_[i].fd = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
                     compress_array = true;
                     continue;
@@ -91,57 +157,11 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
                 panicIfUnexpected(fds_[i].revents != POLLRDNORM, "revents != POLLRDNORM");
 
                 if (fds_[i].fd == listen_sd_) {
-                    do {
-                        auto new_socket = acceptNewSocket(listen_sd_);
-                        if (new_socket == NADJIEB_MJPEG_STREAMER_INVALID_SOCKET) {
-                            panicIfUnexpected(
-                                NADJIEB_MJPEG_STREAMER_ERRNO != NADJIEB_MJPEG_STREAMER_EWOULDBLOCK, "accept() failed");
-                            break;
-                        }
-
-                        setSocketNonblock(new_socket);
-
-                        fds_.emplace_back(NADJIEB_MJPEG_STREAMER_POLLFD{new_socket, POLLRDNORM, 0});
-                    } while (true);
-                } else {
-                    std::string data;
-                    bool close_conn = false;
-
-                    do {
-                        auto size = readFromSocket(fds_[i].fd, &buff[0], buff.size(), 0);
-                        if (size == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR) {
-                            if (NADJIEB_MJPEG_STREAMER_ERRNO != NADJIEB_MJPEG_STREAMER_EWOULDBLOCK) {
-                                std::cerr << "readFromSocket() failed" << std::endl;
-                                close_conn = true;
-                            }
-                            break;
-                        }
-
-                        if (size == 0) {
-                            close_conn = true;
-                            break;
-                        }
-
-                        data += buff.substr(0, size);
-                    } while (true);
-
-                    if (!close_conn) {
-                        auto resp = on_message_cb_(fds_[i].fd, data);
-                        if (resp.close_conn) {
-                            close_conn = resp.close_conn;
-                        }
-
-                        if (resp.end_listener) {
-                            end_listener_ = resp.end_listener;
-                        }
-                    }
-
-                    if (close_conn) {
-                        on_before_close_cb_(fds_[i].fd);
-                        closeSocket(fds_[i].fd);
-                        fds_[i].fd = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
-                        compress_array = true;
-                    }
+                    acceptConnections();
+                } else if (onReadable(*connections_[fds_[i].fd])) {
+                    closeConnection(fds_[i].fd);
+                    fds_[i].fd = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
+                    compress_array = true;
                 }
             }
 
@@ -149,17 +169,139 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
                 compress();
             }
         }
+    }
 
-        closeAll();
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+    void runEpoll() {
+        epoll_fd_ = createEpoll();
+        addToEpoll(epoll_fd_, listen_sd_, EPOLLIN | EPOLLET, nullptr);
+
+        std::vector<struct epoll_event> events(64);
+
+        state_ = nadjieb::utils::State::RUNNING;
+
+        while (!end_listener_) {
+            int event_count = waitEpoll(epoll_fd_, &events[0], (int)events.size(), 100);
+
+            panicIfUnexpected(event_count == -1, "waitEpoll() failed");
+
+            for (int i = 0; i < event_count; ++i) {
+                auto* conn = static_cast<Connection*>(events[i].data.ptr);
+
+                if (conn == nullptr) {
+                    acceptConnections();
+                    continue;
+                }
+
+                if ((events[i].events & (EPOLLERR | EPOLLHUP)) || onReadable(*conn)) {
+                    closeConnection(conn->sockfd);
+                }
+            }
+        }
     }
+#endif
+
+    void acceptConnections() {
+        do {
+            auto new_socket = acceptNewSocket(listen_sd_);
+            if (new_socket == NADJIEB_MJPEG_STREAMER_INVALID_SOCKET) {
+                panicIfUnexpected(
+                    NADJIEB_MJPEG_STREAMER_ERRNO != NADJIEB_MJPEG_STREAMER_EWOULDBLOCK, "accept() failed");
+                break;
+            }
 
-   private:
-    SocketFD listen_sd_ = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
-    bool end_listener_ = true;
-    std::vector<NADJIEB_MJPEG_STREAMER_POLLFD> fds_;
-    OnMessageCallback on_message_cb_;
-    OnBeforeCloseCallback on_before_close_cb_;
-    std::thread thread_listener_;
+            setSocketNonblock(new_socket);
+
+            auto& conn = connections_[new_socket];
+            conn.reset(new Connection(new_socket));
+            connections_accepted_.add();
+            connections_open_.set((int64_t)connections_.size());
+
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+            if (engine_ == ListenerEngine::EPOLL) {
+                addToEpoll(epoll_fd_, new_socket, EPOLLIN | EPOLLRDHUP | EPOLLET, conn.get());
+                continue;
+            }
+#endif
+            fds_.emplace_back(NADJIEB_MJPEG_STREAMER_POLLFD{new_socket, POLLRDNORM, 0});
+        } while (true);
+    }
+
+    // Drains the socket into the connection's parser and hands a complete request to the
+    // callback. Returns true if the connection should be closed.
+    bool onReadable(Connection& conn) {
+        bool close_conn = false;
+
+        do {
+            auto size = readFromSocket(conn.sockfd, &buff_[0], buff_.size(), 0);
+            if (size == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR) {
+                if (NADJIEB_MJPEG_STREAMER_ERRNO != NADJIEB_MJPEG_STREAMER_EWOULDBLOCK) {
+                    std::cerr << "readFromSocket() failed" << std::endl;
+                    close_conn = true;
+                }
+                break;
+            }
+
+            if (size == 0) {
+                close_conn = true;
+                break;
+            }
+
+            conn.request.parse(&buff_[0], size);
+        } while (true);
+
+        if (close_conn || conn.dispatched) {
+            return close_conn;
+        }
+
+        switch (conn.request.getStatus()) {
+            case HTTPRequest::ParseStatus::INCOMPLETE:
+                return false;
+            case HTTPRequest::ParseStatus::COMPLETE:
+                break;
+            default:
+                rejectRequest(conn);
+                return true;
+        }
+
+        conn.dispatched = true;
+
+        auto resp = on_message_cb_(conn.sockfd, conn.request);
+        if (resp.close_conn) {
+            close_conn = resp.close_conn;
+        }
+
+        if (resp.end_listener) {
+            end_listener_ = resp.end_listener;
+        }
+
+        return close_conn;
+    }
+
+    void rejectRequest(const Connection& conn) {
+        const char* res_str;
+        switch (conn.request.getStatus()) {
+            case HTTPRequest::ParseStatus::HEADER_TOO_LARGE:
+                res_str = "HTTP/1.1 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+                break;
+            case HTTPRequest::ParseStatus::BODY_TOO_LARGE:
+                res_str = "HTTP/1.1 413 Payload Too Large\r\nConnection: close\r\n\r\n";
+                break;
+            default:
+                res_str = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+                break;
+        }
+
+        sendViaSocket(conn.sockfd, res_str, std::strlen(res_str), 0);
+    }
+
+    // Closing the socket also removes it from the epoll set.
+    void closeConnection(SocketFD sockfd) {
+        on_before_close_cb_(sockfd);
+        closeSocket(sockfd);
+        connections_.erase(sockfd);
+        connections_open_.set((int64_t)connections_.size());
+    }
 
     void compress() {
         for (auto it = fds_.begin(); it != fds_.end();) {
@@ -173,19 +315,31 @@ class Listener : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runn
 
     void closeAll() {
         state_ = nadjieb::utils::State::TERMINATING;
-        for (auto& pfd : fds_) {
-            if (pfd.fd >= 0) {
-                on_before_close_cb_(pfd.fd);
-                closeSocket(pfd.fd);
-            }
+        for (auto& conn : connections_) {
+            on_before_close_cb_(conn.first);
+            closeSocket(conn.first);
+        }
+
+        if (listen_sd_ != NADJIEB_MJPEG_STREAMER_INVALID_SOCKET) {
+            closeSocket(listen_sd_);
+            listen_sd_ = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET;
+        }
+
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        if (epoll_fd_ != -1) {
+            ::close(epoll_fd_);
+            epoll_fd_ = -1;
         }
+#endif
 
+        connections_.clear();
+        connections_open_.set(0);
         fds_.clear();
         destroySocket();
         state_ = nadjieb::utils::State::TERMINATED;
     }
 
-    void panicIfUnexpected(bool condition, const std::string& message) {
+    void panicIfUnexpected(bool condition, const char* message) {
         if (condition) {
             closeAll();
             throw std::runtime_error(message);
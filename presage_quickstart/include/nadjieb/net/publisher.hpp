@@ -1,14 +1,20 @@
 #pragma once
 
+#include <nadjieb/net/client.hpp>
+#include <nadjieb/net/frame.hpp>
 #include <nadjieb/net/socket.hpp>
 #include <nadjieb/net/topic.hpp>
+#include <nadjieb/utils/metrics.hpp>
 #include <nadjieb/utils/non_copyable.hpp>
 #include <nadjieb/utils/runnable.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -17,141 +23,528 @@
 
 namespace nadjieb {
 namespace net {
+// QUEUE schedules every published frame for each client, up to LIMIT_QUEUE_PER_CLIENT.
+// LATEST keeps a single pending slot per client that newer frames overwrite, so a
+// lagging client is never more than one frame behind.
+enum class DeliveryMode { QUEUE, LATEST };
+
+struct PublisherStats {
+    // Frames written completely to a client.
+    uint64_t frames_sent = 0;
+    // Frames that hit a full socket buffer and finished once the socket drained.
+    uint64_t frames_deferred = 0;
+    // Frames a client never received: queue limit reached, overwritten in the LATEST
+    // slot, skipped while the socket was blocked, older than the client's max lag, or
+    // aborted by a send error.
+    uint64_t frames_dropped = 0;
+    // Frames withheld to hold a client to the frame rate it asked for.
+    uint64_t frames_paced = 0;
+
+    // Gauges sampled when the stats are read, for callers that adapt to the viewers.
+    // Connected clients, and those currently blocked on a full socket.
+    uint64_t clients = 0;
+    uint64_t clients_waiting = 0;
+};
+
 class Publisher : public nadjieb::utils::NonCopyable, public nadjieb::utils::Runnable {
    public:
     virtual ~Publisher() { stop(); }
 
-    void start(int num_workers = std::thread::hardware_concurrency()) {
+    // A couple of shards keep up with several 30 fps viewers; one thread per core only
+    // adds wakeups and contention.
+    static int defaultNumWorkers() {
+        return (int)std::max(1u, std::min(2u, std::thread::hardware_concurrency()));
+    }
+
+    // Shards are created on the first start and live as long as the publisher, so a producer
+    // that passed the end_publisher_ check just before stop() still finds its shard.
+    void start(int num_workers = defaultNumWorkers()) {
         state_ = nadjieb::utils::State::BOOTING;
+        if (shards_.empty()) {
+            num_workers = std::max(1, num_workers);
+            shards_.reserve(num_workers);
+            for (auto i = 0; i < num_workers; ++i) {
+                shards_.emplace_back(new Shard());
+            }
+        }
+
         end_publisher_ = false;
-        workers_.reserve(num_workers);
-        for (auto i = 0; i < num_workers; ++i) {
-            workers_.emplace_back(&Publisher::worker, this);
+        for (auto& shard : shards_) {
+            shard->thread = std::thread(&Publisher::worker, this, shard.get());
         }
         state_ = nadjieb::utils::State::RUNNING;
     }
 
+    // Only joins the workers. Runs on the listener thread for /shutdown while producers may
+    // still be publishing, so the shards themselves are released by the destructor.
     void stop() {
         state_ = nadjieb::utils::State::TERMINATING;
         end_publisher_ = true;
-        condition_.notify_all();
 
-        if (!workers_.empty()) {
-            for (auto& w : workers_) {
-                if (w.joinable()) {
-                    w.join();
-                }
+        for (auto& shard : shards_) {
+            { std::unique_lock<std::mutex> lock(shard->mtx); }
+            wake(*shard);
+        }
+
+        for (auto& shard : shards_) {
+            if (shard->thread.joinable()) {
+                shard->thread.join();
             }
-            workers_.clear();
         }
 
-        topics_.clear();
-        path_by_client_.clear();
+        state_ = nadjieb::utils::State::TERMINATED;
+    }
+
+    void setDeliveryMode(DeliveryMode mode) { delivery_mode_ = mode; }
 
-        while (!payloads_.empty()) {
-            payloads_.pop();
+    // Returns the topic for `path`, creating it with `type` on first use. Registration copies
+    // the registry, so do it up front and publish through the handle on the hot path.
+    TopicHandle registerTopic(const std::string& path, TopicType type = TopicType::MJPEG) {
+        std::unique_lock<std::mutex> lock(topics_mtx_);
+
+        auto topics = std::atomic_load(&topics_);
+        auto it = topics->find(path);
+        if (it != topics->end()) {
+            return it->second;
         }
-        state_ = nadjieb::utils::State::TERMINATED;
+
+        auto topic = std::make_shared<Topic>(path, type);
+        auto next_topics = std::make_shared<TopicMap>(*topics);
+        next_topics->emplace(path, topic);
+        std::atomic_store(&topics_, std::shared_ptr<const TopicMap>(std::move(next_topics)));
+
+        return topic;
     }
 
-    void add(const SocketFD& sockfd, const std::string& path) {
+    TopicHandle findTopic(const std::string& path) const {
+        auto topics = std::atomic_load(&topics_);
+        auto it = topics->find(path);
+        return (it != topics->end()) ? it->second : nullptr;
+    }
+
+    void add(const SocketFD& sockfd, const std::string& path, const ClientOptions& options = ClientOptions()) {
         if (end_publisher_) {
             return;
         }
 
-        topics_[path].addClient(sockfd);
+        auto topic = registerTopic(path);
+
+        // Pin the client to one shard so only that shard's thread ever writes to the socket.
+        auto shard = next_shard_++ % shards_.size();
+        auto client = std::make_shared<Client>(sockfd, shard, topic->getMetrics(), options);
+        topic->addClient(client);
+
+        {
+            std::unique_lock<std::mutex> lock(topic_by_client_mtx_);
+            topic_by_client_[sockfd] = topic;
+        }
+
+        // In LATEST mode a new viewer starts from the current frame instead of waiting for the
+        // next publish, which matters for slow topics such as event streams.
+        auto frame = topic->getFrame();
+        bool replaced = false;
+        if (delivery_mode_ == DeliveryMode::LATEST && frame && client->offerFrame(std::move(frame), replaced)) {
+            schedule(topic.get(), client);
+        }
+    }
+
+    // Sends `frame` once, preceded by the complete response `head`, then ends the
+    // connection. Written by a shard like any stream, so a large frame never blocks the caller.
+    // Returns false if the publisher is stopped; the caller still owns the connection then.
+    bool addSnapshot(const SocketFD& sockfd, std::string head, FramePtr frame) {
+        if (end_publisher_) {
+            return false;
+        }
+
+        auto client = std::make_shared<Client>(sockfd, next_shard_++ % shards_.size(), snapshot_metrics_);
+        client->setSnapshot(std::move(head));
+        bool replaced = false;
+        client->offerFrame(std::move(frame), replaced);
 
-        std::unique_lock<std::mutex> lock(path_by_client_mtx_);
-        path_by_client_[sockfd] = path;
+        {
+            std::unique_lock<std::mutex> lock(topic_by_client_mtx_);
+            snapshot_clients_[sockfd] = client;
+        }
+
+        schedule(nullptr, client);
+        return true;
     }
 
-    bool pathExists(const std::string& path) { return (topics_.find(path) != topics_.end()); }
+    bool pathExists(const std::string& path) const { return (findTopic(path) != nullptr); }
 
     void removeClient(const SocketFD& sockfd) {
-        std::unique_lock<std::mutex> lock(path_by_client_mtx_);
-        topics_[path_by_client_[sockfd]].removeClient(sockfd);
+        std::unique_lock<std::mutex> lock(topic_by_client_mtx_);
+        auto snapshot_it = snapshot_clients_.find(sockfd);
+        if (snapshot_it != snapshot_clients_.end()) {
+            snapshot_it->second->close();
+            snapshot_clients_.erase(snapshot_it);
+            return;
+        }
+
+        auto it = topic_by_client_.find(sockfd);
+        if (it == topic_by_client_.end()) {
+            return;
+        }
+
+        auto client = it->second->removeClient(sockfd);
+        if (client) {
+            client->close();
+        }
+        topic_by_client_.erase(it);
+    }
 
-        path_by_client_.erase(sockfd);
+    void enqueue(const std::string& path, FramePtr frame) {
+        auto topic = findTopic(path);
+        enqueue(topic ? topic : registerTopic(path), std::move(frame));
     }
 
-    void enqueue(const std::string& path, const std::string& buffer) {
+    // Publishing never allocates and never waits on I/O, but it is not lock-free. It takes
+    // short critical sections only: the pooled mutex behind the topic's shared_ptr atomics,
+    // each client's slot mutex in LATEST mode, and the shard mutex of every client it schedules.
+    void enqueue(const TopicHandle& topic, FramePtr frame) {
         if (end_publisher_) {
             return;
         }
 
-        topics_[path].setBuffer(buffer);
+        topic->setFrame(frame);
+        topic->getMetrics().frames_published.add();
 
-        for (const auto& client : topics_[path].getClients()) {
-            if (topics_[path].getQueueSize(client.fd) > LIMIT_QUEUE_PER_CLIENT) {
+        auto now = std::chrono::steady_clock::now();
+        auto snapshot = topic->getClients();
+        for (const auto& client : snapshot->clients) {
+            if (!client->isDue(now)) {
+                frames_paced_.add();
                 continue;
             }
 
-            std::unique_lock<std::mutex> payloads_lock(payloads_mtx_);
-            payloads_.emplace(path, client);
-            topics_[path].increaseQueue(client.fd);
-            payloads_lock.unlock();
+            if (delivery_mode_ == DeliveryMode::LATEST) {
+                bool replaced = false;
+                bool schedule = client->offerFrame(frame, replaced);
+                if (replaced) {
+                    countDropped(*client);
+                }
+                if (!schedule) {
+                    continue;
+                }
+            } else {
+                if (client->getQueueSize() > LIMIT_QUEUE_PER_CLIENT) {
+                    countDropped(*client);
+                    continue;
+                }
+                client->increaseQueue();
+            }
 
-            condition_.notify_one();
+            schedule(topic.get(), client);
         }
     }
 
-    bool hasClient(const std::string& path) { return topics_[path].hasClient(); }
+    PublisherStats getStats() const {
+        PublisherStats stats;
+        stats.frames_sent = frames_sent_.value();
+        stats.frames_deferred = frames_deferred_.value();
+        stats.frames_dropped = frames_dropped_.value();
+        stats.frames_paced = frames_paced_.value();
+        stats.clients_waiting = clients_waiting_;
+
+        std::unique_lock<std::mutex> lock(topic_by_client_mtx_);
+        stats.clients = topic_by_client_.size();
+        return stats;
+    }
+
+    bool hasClient(const std::string& path) const {
+        auto topic = findTopic(path);
+        return (topic && topic->hasClient());
+    }
+
+    bool hasClient(const TopicHandle& topic) const { return topic->hasClient(); }
+
+    std::vector<TopicHandle> getTopics() const {
+        auto topics = std::atomic_load(&topics_);
+        std::vector<TopicHandle> handles;
+        handles.reserve(topics->size());
+        for (const auto& topic : *topics) {
+            handles.push_back(topic.second);
+        }
+        return handles;
+    }
+
+    // Raw counters behind getStats(), for registering with a MetricsRegistry.
+    const nadjieb::utils::Counter& getFramesSent() const { return frames_sent_; }
+
+    const nadjieb::utils::Counter& getFramesDeferred() const { return frames_deferred_; }
+
+    const nadjieb::utils::Counter& getFramesDropped() const { return frames_dropped_; }
+
+    const nadjieb::utils::Counter& getFramesPaced() const { return frames_paced_; }
+
+    // Seconds from sealing a frame to its last byte being accepted by a client's socket.
+    const nadjieb::utils::Histogram& getSendLatency() const { return send_latency_; }
 
    private:
-    typedef std::pair<std::string, NADJIEB_MJPEG_STREAMER_POLLFD> Payload;
-
-    std::condition_variable condition_;
-    std::vector<std::thread> workers_;
-    std::queue<Payload> payloads_;
-    std::unordered_map<SocketFD, std::string> path_by_client_;
-    std::unordered_map<std::string, Topic> topics_;
-    std::mutex cv_mtx_;
-    std::mutex path_by_client_mtx_;
-    std::mutex payloads_mtx_;
-    bool end_publisher_ = true;
+    typedef std::unordered_map<std::string, TopicHandle> TopicMap;
+    typedef std::pair<Topic*, std::shared_ptr<Client>> Payload;
+
+    // One worker thread and its own queue; clients never move between shards. A client whose
+    // socket is full waits in `waiting` until the shard sees it become writable again. It is a
+    // vector rather than a map so parking a client does not allocate once it has grown.
+    struct Shard {
+        std::mutex mtx;
+        std::condition_variable condition;
+        std::vector<Payload> payloads;
+        std::vector<std::shared_ptr<Client>> waiting;
+        std::thread thread;
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::atomic<bool> wake_pending{false};
+#endif
+
+        Shard() {
+            payloads.reserve(16);
+            waiting.reserve(16);
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+            epoll_fd = createEpoll();
+            wake_fd = createWakeEvent();
+            addToEpoll(epoll_fd, wake_fd, EPOLLIN, nullptr);
+#endif
+        }
+
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        // Closed here rather than in stop(), so a late wake() never signals a reused descriptor
+        ~Shard() {
+            ::close(epoll_fd);
+            ::close(wake_fd);
+        }
+#endif
+
+        std::vector<std::shared_ptr<Client>>::iterator findWaiting(const Client* client) {
+            return std::find_if(waiting.begin(), waiting.end(), [client](const std::shared_ptr<Client>& waiting_client) {
+                return waiting_client.get() == client;
+            });
+        }
+
+        // Order does not matter, so the last entry fills the gap
+        std::vector<std::shared_ptr<Client>>::iterator eraseWaiting(std::vector<std::shared_ptr<Client>>::iterator it) {
+            if (it != waiting.end() - 1) {
+                *it = std::move(waiting.back());
+            }
+            waiting.pop_back();
+            return it;
+        }
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<size_t> next_shard_{0};
+    // Read-mostly registry: lookups load a snapshot, registration swaps in a new copy.
+    std::shared_ptr<const TopicMap> topics_ = std::make_shared<const TopicMap>();
+    std::mutex topics_mtx_;
+    std::unordered_map<SocketFD, TopicHandle> topic_by_client_;
+    std::unordered_map<SocketFD, std::shared_ptr<Client>> snapshot_clients_;
+    mutable std::mutex topic_by_client_mtx_;
+    std::atomic<bool> end_publisher_{true};
+    DeliveryMode delivery_mode_ = DeliveryMode::QUEUE;
+    nadjieb::utils::Counter frames_sent_;
+    nadjieb::utils::Counter frames_deferred_;
+    nadjieb::utils::Counter frames_dropped_;
+    nadjieb::utils::Counter frames_paced_;
+    nadjieb::utils::Histogram send_latency_{nadjieb::utils::Histogram::latencyBounds()};
+    DeliveryMetrics snapshot_metrics_;
+    std::atomic<uint64_t> clients_waiting_{0};
 
     const static int LIMIT_QUEUE_PER_CLIENT = 5;
 
-    void worker() {
+    void wake(Shard& shard) {
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        if (!shard.wake_pending.exchange(true)) {
+            signalWakeEvent(shard.wake_fd);
+        }
+#else
+        shard.condition.notify_one();
+#endif
+    }
+
+    void schedule(Topic* topic, const std::shared_ptr<Client>& client) {
+        auto& shard = *shards_[client->getShard()];
+        std::unique_lock<std::mutex> lock(shard.mtx);
+        shard.payloads.emplace_back(topic, client);
+        lock.unlock();
+
+        wake(shard);
+    }
+
+    void worker(Shard* shard) {
+        std::vector<Payload> payloads;
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+        std::vector<struct epoll_event> events(64);
+#else
+        std::vector<NADJIEB_MJPEG_STREAMER_POLLFD> fds;
+        std::vector<std::shared_ptr<Client>> polled;
+#endif
+
         while (!end_publisher_) {
-            std::unique_lock<std::mutex> cv_lock(cv_mtx_);
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+            int event_count = waitEpoll(shard->epoll_fd, &events[0], (int)events.size(), 100);
+            for (int i = 0; i < event_count; ++i) {
+                auto* client = static_cast<Client*>(events[i].data.ptr);
+                if (client == nullptr) {
+                    drainWakeEvent(shard->wake_fd);
+                    continue;
+                }
 
-            condition_.wait(cv_lock, [&]() { return (end_publisher_ || !payloads_.empty()); });
+                auto it = shard->findWaiting(client);
+                if (it != shard->waiting.end()) {
+                    auto waiting_client = *it;
+                    onWritable(*shard, waiting_client);
+                }
+            }
+
+            // Cleared before taking the batch so a payload pushed after the swap wakes us again.
+            shard->wake_pending = false;
+            std::unique_lock<std::mutex> lock(shard->mtx);
+#else
+            std::unique_lock<std::mutex> lock(shard->mtx);
+            auto timeout = std::chrono::milliseconds(shard->waiting.empty() ? 100 : 5);
+            shard->condition.wait_for(
+                lock, timeout, [&]() { return (end_publisher_ || !shard->payloads.empty()); });
+#endif
             if (end_publisher_) {
                 break;
             }
 
-            std::unique_lock<std::mutex> payloads_lock(payloads_mtx_);
+            payloads.swap(shard->payloads);
+            lock.unlock();
+
+#ifndef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+            if (!shard->waiting.empty()) {
+                fds.clear();
+                polled.clear();
+                for (const auto& waiting : shard->waiting) {
+                    fds.emplace_back(NADJIEB_MJPEG_STREAMER_POLLFD{waiting->getSocket(), POLLWRNORM, 0});
+                    polled.push_back(waiting);
+                }
+
+                if (pollSockets(&fds[0], fds.size(), 0) > 0) {
+                    for (size_t i = 0; i < fds.size(); ++i) {
+                        if (fds[i].revents != 0) {
+                            onWritable(*shard, polled[i]);
+                        }
+                    }
+                }
+            }
+#endif
+
+            for (auto& payload : payloads) {
+                auto& client = payload.second;
+                if (client->isSnapshot()) {
+                    deliver(*shard, client, client->takeFrame());
+                } else if (delivery_mode_ == DeliveryMode::LATEST) {
+                    // The slot keeps the newest frame until the socket drains.
+                    if (!client->isWaitingWritable()) {
+                        deliver(*shard, client, client->takeFrame());
+                    }
+                } else {
+                    client->decreaseQueue();
+                    if (client->isWaitingWritable()) {
+                        countDropped(*client);
+                    } else {
+                        deliver(*shard, client, payload.first->getFrame());
+                    }
+                }
+            }
+
+            payloads.clear();
+            dropClosed(*shard);
+        }
+    }
 
-            Payload payload = std::move(payloads_.front());
-            payloads_.pop();
-            topics_[payload.first].decreaseQueue(payload.second.fd);
+    void deliver(Shard& shard, const std::shared_ptr<Client>& client, FramePtr frame) {
+        if (!frame) {
+            return;
+        }
+
+        if (client->isStale(*frame)) {
+            countDropped(*client);
+            return;
+        }
 
-            payloads_lock.unlock();
-            cv_lock.unlock();
+        client->startWrite(std::move(frame));
+        flush(shard, client);
+    }
 
-            auto buffer = topics_[payload.first].getBuffer();
-            std::string res_str
-                = "--nadjiebmjpegstreamer\r\n"
-                  "Content-Type: image/jpeg\r\n"
-                  "Content-Length: "
-                  + std::to_string(buffer.size()) + "\r\n\r\n" + buffer;
+    void onWritable(Shard& shard, const std::shared_ptr<Client>& client) {
+        if (flush(shard, client) == SendStatus::DONE && delivery_mode_ == DeliveryMode::LATEST) {
+            deliver(shard, client, client->takeFrame());
+        }
+    }
 
-            auto socket_count = pollSockets(&payload.second, 1, 1);
+    SendStatus flush(Shard& shard, const std::shared_ptr<Client>& client) {
+        std::unique_lock<std::mutex> lock(client->getCloseMutex());
+        if (client->isClosed()) {
+            return SendStatus::FAILED;
+        }
 
-            if (socket_count == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR) {
-                throw std::runtime_error("pollSockets() failed\n");
+        auto* frame = client->getPendingFrame();
+        auto sealed_at = frame ? frame->getSealedAt() : std::chrono::steady_clock::time_point();
+
+        auto status = client->flush();
+        if (status == SendStatus::WOULD_BLOCK) {
+            if (!client->isWaitingWritable()) {
+                frames_deferred_.add();
+                client->setWaitingWritable(true);
+                shard.waiting.push_back(client);
+                ++clients_waiting_;
+                client->getMetrics().clients_waiting.add(1);
             }
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+            client->setRegistered(armEpoll(
+                shard.epoll_fd, client->getSocket(), EPOLLOUT | EPOLLONESHOT, client.get(), client->isRegistered()));
+#endif
+            return status;
+        }
 
-            if (socket_count == 0) {
-                continue;
+        if (status == SendStatus::DONE) {
+            if (frame) {
+                frames_sent_.add();
+                client->getMetrics().frames_sent.add();
+                send_latency_.observe(
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - sealed_at).count());
             }
+        } else {
+            countDropped(*client);
+        }
+
+        if (client->isSnapshot()) {
+            shutdownSocketWrite(client->getSocket());
+        }
 
-            if (payload.second.revents != POLLWRNORM) {
-                throw std::runtime_error("revents != POLLWRNORM\n");
+        if (client->isWaitingWritable()) {
+            client->setWaitingWritable(false);
+            auto it = shard.findWaiting(client.get());
+            if (it != shard.waiting.end()) {
+                shard.eraseWaiting(it);
             }
+            --clients_waiting_;
+            client->getMetrics().clients_waiting.add(-1);
+        }
+
+        return status;
+    }
 
-            sendViaSocket(payload.second.fd, res_str.c_str(), res_str.size(), 0);
+    void countDropped(const Client& client) {
+        frames_dropped_.add();
+        client.getMetrics().frames_dropped.add();
+    }
+
+    // Closed clients stop getting writability events, so release them here.
+    void dropClosed(Shard& shard) {
+        for (auto it = shard.waiting.begin(); it != shard.waiting.end();) {
+            if ((*it)->isClosed()) {
+                (*it)->getMetrics().clients_waiting.add(-1);
+                it = shard.eraseWaiting(it);
+                --clients_waiting_;
+            } else {
+                ++it;
+            }
         }
     }
 };
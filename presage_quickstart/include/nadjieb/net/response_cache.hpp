@@ -0,0 +1,55 @@
+#pragma once
+
+#include <nadjieb/net/http_response.hpp>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nadjieb {
+namespace net {
+// Fixed responses serialized once for each common HTTP version, so replying to a request
+// costs a single send. Other versions fall back to serializing on demand.
+class ResponseCache {
+   public:
+    // Returns the id used to look the response up again.
+    size_t add(HTTPResponse response) {
+        Entry entry;
+        for (size_t i = 0; i < VERSIONS.size(); ++i) {
+            response.setVersion(VERSIONS[i]);
+            entry.serialized[i] = response.serialize();
+        }
+        entry.response = std::move(response);
+
+        entries_.push_back(std::move(entry));
+        return entries_.size() - 1;
+    }
+
+    // `scratch` is only written when `version` is not cached; the result may point into it.
+    std::string_view get(size_t id, std::string_view version, std::string& scratch) const {
+        const auto& entry = entries_[id];
+        for (size_t i = 0; i < VERSIONS.size(); ++i) {
+            if (version == VERSIONS[i]) {
+                return entry.serialized[i];
+            }
+        }
+
+        auto response = entry.response;
+        response.setVersion(std::string(version));
+        scratch = response.serialize();
+        return scratch;
+    }
+
+   private:
+    static constexpr std::array<const char*, 2> VERSIONS = {"HTTP/1.1", "HTTP/1.0"};
+
+    struct Entry {
+        HTTPResponse response;
+        std::array<std::string, VERSIONS.size()> serialized;
+    };
+
+    std::vector<Entry> entries_;
+};
+}  // namespace net
+}  // namespace nadjieb
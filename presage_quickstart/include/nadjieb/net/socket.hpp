@@ -19,8 +19,11 @@
 #include <errno.h>
 #include <poll.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #elif defined NADJIEB_MJPEG_STREAMER_PLATFORM_DARWIN
 #include <arpa/inet.h>
@@ -29,6 +32,7 @@
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #else
 #error "Unsupported OS, please commit an issue."
@@ -57,6 +61,13 @@ typedef int SocketFD;
 #define NADJIEB_MJPEG_STREAMER_INVALID_SOCKET (-1)
 #endif
 
+#define NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS 4
+
+struct SocketBuffer {
+    const char* data;
+    size_t size;
+};
+
 static void destroySocket() {
 #ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_WINDOWS
     WSACleanup();
@@ -71,15 +82,25 @@ static void closeSocket(SocketFD sockfd) {
 #endif
 }
 
+// Ends our side of the connection; the peer reads EOF once everything sent has arrived.
+static void shutdownSocketWrite(SocketFD sockfd) {
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_WINDOWS
+    ::shutdown(sockfd, SD_SEND);
+#else
+    ::shutdown(sockfd, SHUT_WR);
+#endif
+}
+
+// Takes a literal so the check itself never allocates on hot paths.
 static void panicIfUnexpected(
     bool condition,
-    const std::string& message,
+    const char* message,
     const SocketFD& sockfd = NADJIEB_MJPEG_STREAMER_INVALID_SOCKET) {
     if (condition) {
         if (sockfd != NADJIEB_MJPEG_STREAMER_INVALID_SOCKET) {
             closeSocket(sockfd);
         }
-        throw std::runtime_error(message + " - Error Code: " + std::to_string(NADJIEB_MJPEG_STREAMER_ERRNO));
+        throw std::runtime_error(std::string(message) + " - Error Code: " + std::to_string(NADJIEB_MJPEG_STREAMER_ERRNO));
     }
 }
 
@@ -132,6 +153,15 @@ static void bindSocket(SocketFD sockfd, const char* ip, int port) {
     panicIfUnexpected(res == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR, "bindSocket() failed", sockfd);
 }
 
+// Local port a socket is bound to, e.g. the one the system picked when binding port 0
+static int getSocketPort(SocketFD sockfd) {
+    struct sockaddr_in ip_addr;
+    socklen_t len = sizeof(ip_addr);
+    auto res = ::getsockname(sockfd, (struct sockaddr*)&ip_addr, &len);
+    panicIfUnexpected(res == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR, "getSocketPort() failed");
+    return ntohs(ip_addr.sin_port);
+}
+
 static void listenOnSocket(SocketFD sockfd, int backlog) {
     auto res = ::listen(sockfd, backlog);
     panicIfUnexpected(res == NADJIEB_MJPEG_STREAMER_SOCKET_ERROR, "listenOnSocket() failed", sockfd);
@@ -157,6 +187,34 @@ static int sendViaSocket(SocketFD socket, const char* buffer, size_t length, int
 #endif
 }
 
+static long sendBuffersViaSocket(SocketFD socket, const SocketBuffer* buffers, size_t count) {
+    if (count > NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS) {
+        count = NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS;
+    }
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_WINDOWS
+    WSABUF wsa_buffers[NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS];
+    for (size_t i = 0; i < count; ++i) {
+        wsa_buffers[i].buf = const_cast<char*>(buffers[i].data);
+        wsa_buffers[i].len = (ULONG)buffers[i].size;
+    }
+
+    DWORD sent = 0;
+    auto res = ::WSASend(socket, wsa_buffers, (DWORD)count, &sent, 0, nullptr, nullptr);
+    return (res == SOCKET_ERROR) ? SOCKET_ERROR : (long)sent;
+#else
+    struct iovec iov[NADJIEB_MJPEG_STREAMER_MAX_SOCKET_BUFFERS];
+    for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = const_cast<char*>(buffers[i].data);
+        iov[i].iov_len = buffers[i].size;
+    }
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    return (long)::sendmsg(socket, &msg, 0);
+#endif
+}
+
 static int pollSockets(NADJIEB_MJPEG_STREAMER_POLLFD* fds, size_t nfds, long timeout) {
 #ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_WINDOWS
     return WSAPoll(&fds[0], (ULONG)nfds, timeout);
@@ -164,5 +222,59 @@ static int pollSockets(NADJIEB_MJPEG_STREAMER_POLLFD* fds, size_t nfds, long tim
     return poll(fds, nfds, timeout);
 #endif
 }
+
+#ifdef NADJIEB_MJPEG_STREAMER_PLATFORM_LINUX
+static int createEpoll() {
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    panicIfUnexpected(epfd == -1, "createEpoll() failed");
+
+    return epfd;
+}
+
+static void addToEpoll(int epfd, SocketFD sockfd, uint32_t events, void* data) {
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.ptr = data;
+    auto res = ::epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &event);
+    panicIfUnexpected(res == -1, "addToEpoll() failed");
+}
+
+// Unlike addToEpoll, failures are reported instead of thrown: a client socket may be
+// closed by the listener while a publisher shard is still tracking it.
+static bool armEpoll(int epfd, SocketFD sockfd, uint32_t events, void* data, bool registered) {
+    struct epoll_event event = {};
+    event.events = events;
+    event.data.ptr = data;
+    return (::epoll_ctl(epfd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sockfd, &event) == 0);
+}
+
+static int waitEpoll(int epfd, struct epoll_event* events, int max_events, int timeout) {
+    int count = ::epoll_wait(epfd, events, max_events, timeout);
+    if (count == -1 && errno == EINTR) {
+        return 0;
+    }
+
+    return count;
+}
+
+static int createWakeEvent() {
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    panicIfUnexpected(fd == -1, "createWakeEvent() failed");
+
+    return fd;
+}
+
+static void signalWakeEvent(int fd) {
+    uint64_t value = 1;
+    auto res = ::write(fd, &value, sizeof(value));
+    (void)res;
+}
+
+static void drainWakeEvent(int fd) {
+    uint64_t value;
+    auto res = ::read(fd, &value, sizeof(value));
+    (void)res;
+}
+#endif
 }  // namespace net
 }  // namespace nadjieb
@@ -1,82 +1,113 @@
 #pragma once
 
+#include <nadjieb/net/client.hpp>
+#include <nadjieb/net/frame.hpp>
 #include <nadjieb/net/socket.hpp>
+#include <nadjieb/utils/non_copyable.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace nadjieb {
 namespace net {
-class Topic {
+// Immutable list of a topic's subscribers. `version` increases on every add/remove.
+struct ClientSnapshot {
+    uint64_t version = 0;
+    std::vector<std::shared_ptr<Client>> clients;
+};
+
+// What a topic's frames are: JPEG parts of a multipart/x-mixed-replace stream, or
+// server-sent events of a text/event-stream.
+enum class TopicType { MJPEG, EVENT_STREAM };
+
+class Topic : public nadjieb::utils::NonCopyable {
    public:
-    void setBuffer(const std::string& buffer) {
-        std::unique_lock lock(buffer_mtx_);
-        buffer_ = buffer;
-    }
+    explicit Topic(std::string path, TopicType type = TopicType::MJPEG) : path_(std::move(path)), type_(type) {}
 
-    std::string getBuffer() {
-        std::shared_lock lock(buffer_mtx_);
-        return buffer_;
-    }
+    const std::string& getPath() const { return path_; }
 
-    void addClient(const SocketFD& sockfd) {
-        std::unique_lock client_lock(client_by_sockfd_mtx_);
-        client_by_sockfd_[sockfd] = NADJIEB_MJPEG_STREAMER_POLLFD{sockfd, POLLWRNORM, 0};
+    TopicType getType() const { return type_; }
 
-        std::unique_lock queue_size_lock(queue_size_by_sockfd__mtx_);
-        queue_size_by_sockfd_[sockfd] = 0;
-    }
+    DeliveryMetrics& getMetrics() { return metrics_; }
 
-    void removeClient(const SocketFD& sockfd) {
-        std::unique_lock lock(client_by_sockfd_mtx_);
-        client_by_sockfd_.erase(sockfd);
+    // The shared_ptr atomics are not lock-free in libstdc++: they take a mutex from an internal
+    // pool, held just long enough to copy the pointer and bump its reference count.
+    void setFrame(FramePtr frame) { std::atomic_store(&frame_, std::move(frame)); }
 
-        std::unique_lock queue_size_lock(queue_size_by_sockfd__mtx_);
-        queue_size_by_sockfd_.erase(sockfd);
-    }
+    FramePtr getFrame() const { return std::atomic_load(&frame_); }
 
-    bool hasClient() {
-        std::shared_lock lock(client_by_sockfd_mtx_);
-        return !client_by_sockfd_.empty();
-    }
+    // Copy-on-write: subscribers change rarely, so add/remove build a new list under
+    // clients_mtx_ and publishing iterates an immutable snapshot without allocating. Loading
+    // the snapshot goes through the same pooled mutex as setFrame, never clients_mtx_.
+    void addClient(const std::shared_ptr<Client>& client) {
+        std::unique_lock<std::mutex> lock(clients_mtx_);
+        auto current = std::atomic_load(&clients_);
 
-    std::vector<NADJIEB_MJPEG_STREAMER_POLLFD> getClients() {
-        std::shared_lock lock(client_by_sockfd_mtx_);
+        auto next = std::make_shared<ClientSnapshot>();
+        next->version = current->version + 1;
+        next->clients.reserve(current->clients.size() + 1);
+        next->clients = current->clients;
+        next->clients.push_back(client);
 
-        std::vector<NADJIEB_MJPEG_STREAMER_POLLFD> clients;
-        for (const auto& client : client_by_sockfd_) {
-            clients.push_back(client.second);
+        std::atomic_store(&clients_, std::shared_ptr<const ClientSnapshot>(std::move(next)));
+    }
+
+    std::shared_ptr<Client> removeClient(const SocketFD& sockfd) {
+        std::unique_lock<std::mutex> lock(clients_mtx_);
+        auto current = std::atomic_load(&clients_);
+
+        std::shared_ptr<Client> removed;
+        auto next = std::make_shared<ClientSnapshot>();
+        next->version = current->version + 1;
+        for (const auto& client : current->clients) {
+            if (client->getSocket() != sockfd) {
+                next->clients.push_back(client);
+            } else {
+                removed = client;
+            }
         }
 
-        return clients;
+        std::atomic_store(&clients_, std::shared_ptr<const ClientSnapshot>(std::move(next)));
+        return removed;
     }
 
-    int getQueueSize(const SocketFD& sockfd) {
-        std::shared_lock queue_size_lock(queue_size_by_sockfd__mtx_);
-        return queue_size_by_sockfd_[sockfd];
-    }
+    bool hasClient() const { return !std::atomic_load(&clients_)->clients.empty(); }
+
+    std::shared_ptr<const ClientSnapshot> getClients() const { return std::atomic_load(&clients_); }
 
-    void increaseQueue(const SocketFD& sockfd) {
-        std::unique_lock queue_size_lock(queue_size_by_sockfd__mtx_);
-        ++queue_size_by_sockfd_[sockfd];
+    // Snapshot requests leave no subscriber behind, so they are remembered here for producers
+    // that only publish while there is demand.
+    void noteSnapshotRequest() {
+        last_snapshot_request_.store(
+            std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
     }
 
-    void decreaseQueue(const SocketFD& sockfd) {
-        std::unique_lock queue_size_lock(queue_size_by_sockfd__mtx_);
-        --queue_size_by_sockfd_[sockfd];
+    // True if a snapshot was requested within `window`
+    bool hasSnapshotDemand(std::chrono::steady_clock::duration window) const {
+        auto last = last_snapshot_request_.load(std::memory_order_relaxed);
+        auto requested_at = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last));
+        return last != 0 && std::chrono::steady_clock::now() - requested_at < window;
     }
 
    private:
-    std::string buffer_;
-    std::shared_mutex buffer_mtx_;
-
-    std::unordered_map<SocketFD, NADJIEB_MJPEG_STREAMER_POLLFD> client_by_sockfd_;
-    std::shared_mutex client_by_sockfd_mtx_;
-
-    std::unordered_map<SocketFD, int> queue_size_by_sockfd_;
-    std::shared_mutex queue_size_by_sockfd__mtx_;
+    const std::string path_;
+    const TopicType type_;
+    FramePtr frame_;
+    DeliveryMetrics metrics_;
+
+    std::shared_ptr<const ClientSnapshot> clients_ = std::make_shared<const ClientSnapshot>();
+    std::mutex clients_mtx_;
+    std::atomic<std::chrono::steady_clock::rep> last_snapshot_request_{0}; // 0 until the first
 };
+
+// Handle returned by Publisher::registerTopic. Topics are never unregistered, so a handle
+// stays valid for the lifetime of the publisher.
+typedef std::shared_ptr<Topic> TopicHandle;
 }  // namespace net
 }  // namespace nadjieb
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <nadjieb/utils/non_copyable.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define NADJIEB_MJPEG_STREAMER_METRICS_SLOTS 16
+
+namespace nadjieb {
+namespace utils {
+// Each thread updates its own cache line of a metric, so hot paths never contend on a
+// shared counter. Readers sum the slots when metrics are scraped.
+inline size_t metricsSlot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot++ % NADJIEB_MJPEG_STREAMER_METRICS_SLOTS;
+    return slot;
+}
+
+class Counter : public NonCopyable {
+   public:
+    void add(uint64_t value = 1) { slots_[metricsSlot()].value.fetch_add(value, std::memory_order_relaxed); }
+
+    uint64_t value() const {
+        uint64_t sum = 0;
+        for (const auto& slot : slots_) {
+            sum += slot.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+   private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Slot slots_[NADJIEB_MJPEG_STREAMER_METRICS_SLOTS];
+};
+
+// A value that goes up and down, such as open connections. Writes are rare enough that a
+// single atomic is fine.
+class Gauge : public NonCopyable {
+   public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+
+    void add(int64_t value) { value_.fetch_add(value, std::memory_order_relaxed); }
+
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Distribution over fixed upper bounds, e.g. durations in seconds. Observing finds the
+// bucket and bumps it in the calling thread's slot.
+class Histogram : public NonCopyable {
+   public:
+    explicit Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+        for (auto& slot : slots_) {
+            slot.counts.reset(new std::atomic<uint64_t>[bounds_.size() + 1]());
+        }
+    }
+
+    void observe(double value) {
+        size_t bucket = 0;
+        while (bucket < bounds_.size() && value > bounds_[bucket]) {
+            ++bucket;
+        }
+
+        auto& slot = slots_[metricsSlot()];
+        slot.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+        auto sum = slot.sum.load(std::memory_order_relaxed);
+        while (!slot.sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+        }
+    }
+
+    const std::vector<double>& getBounds() const { return bounds_; }
+
+    // Non-cumulative counts per bucket; the last entry counts values above every bound.
+    std::vector<uint64_t> getCounts() const {
+        std::vector<uint64_t> counts(bounds_.size() + 1, 0);
+        for (const auto& slot : slots_) {
+            for (size_t i = 0; i < counts.size(); ++i) {
+                counts[i] += slot.counts[i].load(std::memory_order_relaxed);
+            }
+        }
+        return counts;
+    }
+
+    double getSum() const {
+        double sum = 0;
+        for (const auto& slot : slots_) {
+            sum += slot.sum.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    // Bounds from 0.5 ms to 1 s, suited to per-frame and per-request durations in seconds.
+    static std::vector<double> latencyBounds() {
+        return {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0};
+    }
+
+   private:
+    struct alignas(64) Slot {
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;
+        std::atomic<double> sum{0};
+    };
+
+    std::vector<double> bounds_;
+    Slot slots_[NADJIEB_MJPEG_STREAMER_METRICS_SLOTS];
+};
+
+// Named metrics rendered in the Prometheus text exposition format. Metrics are either owned
+// by the registry (counter(), gauge(), histogram()) or owned elsewhere and added by pointer,
+// in which case they must outlive the registry. Values only known at scrape time, such as
+// per-topic state, come from collectors. Registration takes a lock; updates never do.
+class MetricsRegistry : public NonCopyable {
+   public:
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Sample {
+        std::string labels;  // e.g. topic="/video_feed"
+        double value;
+    };
+
+    using Collector = std::function<void(std::vector<Sample>&)>;
+
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        auto counter = std::make_shared<Counter>();
+        add(name, help, counter.get(), labels);
+        keep(counter);
+        return *counter;
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        auto gauge = std::make_shared<Gauge>();
+        add(name, help, gauge.get(), labels);
+        keep(gauge);
+        return *gauge;
+    }
+
+    Histogram& histogram(
+        const std::string& name,
+        const std::string& help,
+        std::vector<double> bounds = Histogram::latencyBounds(),
+        const std::string& labels = "") {
+        auto histogram = std::make_shared<Histogram>(std::move(bounds));
+        add(name, help, histogram.get(), labels);
+        keep(histogram);
+        return *histogram;
+    }
+
+    void add(const std::string& name, const std::string& help, const Counter* counter, const std::string& labels = "") {
+        addEntry(name, help, Type::COUNTER, labels, [counter](std::vector<Sample>& samples, const std::string& l) {
+            samples.push_back(Sample{l, (double)counter->value()});
+        });
+    }
+
+    void add(const std::string& name, const std::string& help, const Gauge* gauge, const std::string& labels = "") {
+        addEntry(name, help, Type::GAUGE, labels, [gauge](std::vector<Sample>& samples, const std::string& l) {
+            samples.push_back(Sample{l, (double)gauge->value()});
+        });
+    }
+
+    void add(const std::string& name, const std::string& help, const Histogram* histogram, const std::string& labels = "") {
+        std::unique_lock<std::mutex> lock(mtx_);
+        family(name, help, Type::HISTOGRAM).histograms.emplace_back(labels, histogram);
+    }
+
+    // Formats one `name="value"` label pair, escaping the value as the exposition format requires.
+    static std::string label(const std::string& name, const std::string& value) {
+        std::string out = name + "=\"";
+        for (auto c : value) {
+            if (c == '\\' || c == '"') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    // `collector` appends one sample per label set each time the registry is rendered.
+    void addCollector(const std::string& name, const std::string& help, Type type, Collector collector) {
+        addEntry(name, help, type, "", [collector](std::vector<Sample>& samples, const std::string&) {
+            collector(samples);
+        });
+    }
+
+    std::string render() const {
+        std::unique_lock<std::mutex> lock(mtx_);
+        std::ostringstream out;
+        std::vector<Sample> samples;
+
+        for (const auto& family : families_) {
+            out << "# HELP " << family.name << " " << family.help << "\n";
+            out << "# TYPE " << family.name << " " << typeName(family.type) << "\n";
+
+            samples.clear();
+            for (const auto& entry : family.entries) {
+                entry.second(samples, entry.first);
+            }
+            for (const auto& sample : samples) {
+                out << family.name << wrap(sample.labels) << " " << format(sample.value) << "\n";
+            }
+
+            for (const auto& entry : family.histograms) {
+                renderHistogram(out, family.name, entry.first, *entry.second);
+            }
+        }
+
+        return out.str();
+    }
+
+   private:
+    using Entry = std::pair<std::string, std::function<void(std::vector<Sample>&, const std::string&)>>;
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<Entry> entries;
+        std::vector<std::pair<std::string, const Histogram*>> histograms;
+    };
+
+    mutable std::mutex mtx_;
+    std::vector<Family> families_;
+    std::vector<std::shared_ptr<void>> owned_;
+
+    void keep(std::shared_ptr<void> metric) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        owned_.push_back(std::move(metric));
+    }
+
+    void addEntry(
+        const std::string& name,
+        const std::string& help,
+        Type type,
+        const std::string& labels,
+        std::function<void(std::vector<Sample>&, const std::string&)> read) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        family(name, help, type).entries.emplace_back(labels, std::move(read));
+    }
+
+    Family& family(const std::string& name, const std::string& help, Type type) {
+        for (auto& family : families_) {
+            if (family.name == name) {
+                return family;
+            }
+        }
+
+        families_.push_back(Family{name, help, type, {}, {}});
+        return families_.back();
+    }
+
+    static void renderHistogram(
+        std::ostringstream& out, const std::string& name, const std::string& labels, const Histogram& histogram) {
+        auto counts = histogram.getCounts();
+        const auto& bounds = histogram.getBounds();
+        auto prefix = labels.empty() ? "" : labels + ",";
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            cumulative += counts[i];
+            out << name << "_bucket{" << prefix << "le=\"";
+            if (i < bounds.size()) {
+                out << format(bounds[i]);
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+
+        out << name << "_sum" << wrap(labels) << " " << format(histogram.getSum()) << "\n";
+        out << name << "_count" << wrap(labels) << " " << cumulative << "\n";
+    }
+
+    // Whole numbers print without an exponent so large counters stay exact.
+    static std::string format(double value) {
+        char buffer[32];
+        if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+            std::snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        }
+        return buffer;
+    }
+
+    static std::string wrap(const std::string& labels) { return labels.empty() ? "" : "{" + labels + "}"; }
+
+    static const char* typeName(Type type) {
+        switch (type) {
+            case Type::COUNTER:
+                return "counter";
+            case Type::GAUGE:
+                return "gauge";
+            default:
+                return "histogram";
+        }
+    }
+};
+}  // namespace utils
+}  // namespace nadjieb
@@ -0,0 +1,271 @@
+// raw_vitals_format.hpp
+// Raw vitals samples: the CSV row layout of raw_vitals_log.csv and the fixed-width binary
+// layout of raw_vitals_log.bin, with a memory-mapped writer and reader for the latter.
+//
+// Binary layout (little-endian, as written by the host):
+//   RawVitalsFileHeader (256 bytes): magic, format version, record and header sizes, the
+//   number of records written, and the record schema as text.
+//   RawVitalsRecord[record_count] (28 bytes each), in the order they were logged.
+// The file grows in GROW_BYTES chunks while it is written and is trimmed when closed, so a
+// reader trusts record_count rather than the file size.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vitals {
+
+#pragma pack(push, 4)
+// One sample of the raw log
+struct RawVitalsRecord {
+    int32_t sample_index;    // 1-based within the question
+    int32_t question_number;
+    int64_t timestamp;       // SDK timestamp of the pulse reading
+    float pulse;             // BPM
+    float breathing;         // BPM
+    float confidence;        // Pulse confidence
+};
+#pragma pack(pop)
+static_assert(sizeof(RawVitalsRecord) == 28, "RawVitalsRecord is written to disk as is");
+
+constexpr const char* RAW_VITALS_CSV_HEADER =
+    "sample_index,question_number,timestamp,pulse_bpm,breathing_bpm,pulse_confidence\n";
+
+// Longest row FormatCsvRow can produce, newline included
+constexpr size_t RAW_VITALS_CSV_ROW_MAX = 128;
+
+// Writes `record` as one CSV row at `out` and returns the end of it. Floats keep six
+// significant digits, as the original ostream output did.
+inline char* FormatCsvRow(const RawVitalsRecord& record, char* out) {
+    char* end = out + RAW_VITALS_CSV_ROW_MAX - 8; // Room for the separators after the last field
+    out = std::to_chars(out, end, record.sample_index).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, record.question_number).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, record.timestamp).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, record.pulse, std::chars_format::general, 6).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, record.breathing, std::chars_format::general, 6).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, record.confidence, std::chars_format::general, 6).ptr;
+    *out++ = '\n';
+    return out;
+}
+
+struct RawVitalsFileHeader {
+    char magic[8];           // "RVITALS\0"
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t header_size;
+    uint32_t reserved;
+    uint64_t record_count;
+    char schema[224];        // Field names and types, for tools that do not include this header
+};
+static_assert(sizeof(RawVitalsFileHeader) == 256, "RawVitalsFileHeader is written to disk as is");
+
+constexpr char RAW_VITALS_MAGIC[8] = {'R', 'V', 'I', 'T', 'A', 'L', 'S', '\0'};
+constexpr uint32_t RAW_VITALS_VERSION = 1;
+constexpr const char* RAW_VITALS_SCHEMA =
+    "sample_index:i32,question_number:i32,timestamp:i64,pulse_bpm:f32,breathing_bpm:f32,pulse_confidence:f32";
+static_assert(sizeof(RawVitalsFileHeader::schema) > std::char_traits<char>::length(RAW_VITALS_SCHEMA),
+              "schema must fit the header");
+
+// Appends records to a raw_vitals_log.bin through a shared mapping, so logging a sample is
+// a copy into memory. The file grows by GROW_BYTES at a time, allocated on disk before it is
+// mapped, and is trimmed to the records written when closed. Append fails if the disk is
+// full. Sync makes everything appended so far durable. Not thread-safe.
+struct RawVitalsFileWriter {
+    static constexpr size_t GROW_BYTES = 1 << 20; // About 37k records, 20 minutes at 30 Hz
+
+    int fd = -1;
+    char* map = nullptr;
+    size_t map_size = 0;
+    uint64_t count = 0;
+    uint64_t synced_count = 0;
+
+    RawVitalsFileWriter() = default;
+    RawVitalsFileWriter(const RawVitalsFileWriter&) = delete;
+    RawVitalsFileWriter& operator=(const RawVitalsFileWriter&) = delete;
+    ~RawVitalsFileWriter() { Close(); }
+
+    bool Open(const char* path) {
+        fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) return false;
+        if (!Grow(sizeof(RawVitalsFileHeader) + GROW_BYTES)) {
+            Close();
+            return false;
+        }
+
+        RawVitalsFileHeader header = {};
+        std::memcpy(header.magic, RAW_VITALS_MAGIC, sizeof(header.magic));
+        header.version = RAW_VITALS_VERSION;
+        header.record_size = sizeof(RawVitalsRecord);
+        header.header_size = sizeof(RawVitalsFileHeader);
+        std::strncpy(header.schema, RAW_VITALS_SCHEMA, sizeof(header.schema) - 1);
+        std::memcpy(map, &header, sizeof(header));
+        return true;
+    }
+
+    bool IsOpen() const { return map != nullptr; }
+
+    bool Append(const RawVitalsRecord* records, size_t n) {
+        if (map == nullptr) return false;
+        size_t offset = sizeof(RawVitalsFileHeader) + count * sizeof(RawVitalsRecord);
+        size_t needed = offset + n * sizeof(RawVitalsRecord);
+        if (needed > map_size && !Grow(needed + GROW_BYTES)) return false;
+
+        std::memcpy(map + offset, records, n * sizeof(RawVitalsRecord));
+        count += n;
+        Header().record_count = count;
+        return true;
+    }
+
+    // Writes back the pages holding records appended since the last sync and the header
+    // page holding their count.
+    bool Sync() {
+        if (map == nullptr || synced_count == count) return true;
+        size_t page = (size_t)::sysconf(_SC_PAGESIZE);
+        size_t begin = (sizeof(RawVitalsFileHeader) + synced_count * sizeof(RawVitalsRecord)) / page * page;
+        size_t end = sizeof(RawVitalsFileHeader) + count * sizeof(RawVitalsRecord);
+        bool ok = ::msync(map + begin, end - begin, MS_SYNC) == 0 && ::msync(map, page, MS_SYNC) == 0;
+        if (ok) synced_count = count;
+        return ok;
+    }
+
+    void Close() {
+        if (map != nullptr) {
+            Sync();
+            ::munmap(map, map_size);
+            map = nullptr;
+            if (::ftruncate(fd, (off_t)(sizeof(RawVitalsFileHeader) + count * sizeof(RawVitalsRecord))) != 0) {
+                // Left at the grown size; readers go by record_count
+            }
+        }
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    RawVitalsFileHeader& Header() { return *reinterpret_cast<RawVitalsFileHeader*>(map); }
+
+    // Reserves the new blocks before mapping them. A sparse extension from ftruncate would
+    // only fail once a store into the mapping hit a full disk, as a SIGBUS.
+    bool Grow(size_t size) {
+        if (int err = ::posix_fallocate(fd, (off_t)map_size, (off_t)(size - map_size))) {
+            errno = err;
+            return false;
+        }
+        void* grown = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (grown == MAP_FAILED) return false;
+        if (map != nullptr) ::munmap(map, map_size);
+        map = static_cast<char*>(grown);
+        map_size = size;
+        return true;
+    }
+};
+
+// Read-only view of a raw_vitals_log.bin. Records are read in place from the mapping, so
+// opening a file costs the same however long the session was.
+struct RawVitalsFileReader {
+    int fd = -1;
+    const char* map = nullptr;
+    size_t map_size = 0;
+    uint64_t count = 0;
+    std::string error;
+
+    RawVitalsFileReader() = default;
+    RawVitalsFileReader(const RawVitalsFileReader&) = delete;
+    RawVitalsFileReader& operator=(const RawVitalsFileReader&) = delete;
+    ~RawVitalsFileReader() { Close(); }
+
+    bool Open(const char* path) {
+        fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return Fail("cannot open file");
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RawVitalsFileHeader)) return Fail("file too short");
+        map_size = (size_t)st.st_size;
+
+        void* mapped = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) return Fail("cannot map file");
+        map = static_cast<const char*>(mapped);
+
+        RawVitalsFileHeader header;
+        std::memcpy(&header, map, sizeof(header));
+        if (std::memcmp(header.magic, RAW_VITALS_MAGIC, sizeof(header.magic)) != 0) return Fail("not a raw vitals file");
+        if (header.version != RAW_VITALS_VERSION) return Fail("unsupported version " + std::to_string(header.version));
+        if (header.record_size != sizeof(RawVitalsRecord) || header.header_size != sizeof(RawVitalsFileHeader)) {
+            return Fail("unexpected record layout");
+        }
+
+        // A file still being written may hold fewer complete records than its count says
+        count = std::min<uint64_t>(header.record_count, (map_size - sizeof(header)) / sizeof(RawVitalsRecord));
+        return true;
+    }
+
+    void Close() {
+        if (map != nullptr) {
+            ::munmap(const_cast<char*>(map), map_size);
+            map = nullptr;
+        }
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+        }
+        count = 0;
+    }
+
+    uint64_t Size() const { return count; }
+
+    RawVitalsRecord At(uint64_t i) const {
+        RawVitalsRecord record;
+        std::memcpy(&record, map + sizeof(RawVitalsFileHeader) + i * sizeof(RawVitalsRecord), sizeof(record));
+        return record;
+    }
+
+    int64_t TimestampAt(uint64_t i) const {
+        int64_t timestamp;
+        std::memcpy(&timestamp,
+                    map + sizeof(RawVitalsFileHeader) + i * sizeof(RawVitalsRecord) + offsetof(RawVitalsRecord, timestamp),
+                    sizeof(timestamp));
+        return timestamp;
+    }
+
+    // Index of the first record with a timestamp not before `timestamp`. Samples are logged
+    // in time order, so this is a binary search over the mapping.
+    uint64_t LowerBound(int64_t timestamp) const {
+        uint64_t lo = 0;
+        uint64_t hi = count;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (TimestampAt(mid) < timestamp) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    bool Fail(std::string message) {
+        error = std::move(message);
+        Close();
+        return false;
+    }
+};
+
+} // namespace vitals
@@ -0,0 +1,207 @@
+// stress_detection.hpp
+// Stress detection on one vital sign: the candidate's running baseline, a hysteresis
+// episode detector, and StressMonitor, which ties the two together per sample.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace vitals {
+
+// The SDK reports a rate of 0 until it has a lock on the signal. Anything at or below this
+// is not a reading and is kept out of averages, baselines and detectors.
+constexpr float MIN_VALID_RATE = 1.0f;
+
+inline bool IsValidRate(float value) { return value > MIN_VALID_RATE; }
+
+// Baseline of one signal as it stood when a question ended
+struct BaselineSummary {
+    double mean;
+    double stddev;
+    size_t samples;
+    bool calibrated;
+};
+
+// One episode of a signal above its stress threshold.
+// time_offset_sec and value mirror start_offset_sec and peak for older readers.
+struct StressEvent {
+    int question_number;
+    double time_offset_sec; // Seconds from start of question
+    std::string type;       // "Pulse" or "Breathing"
+    float value;
+    double start_offset_sec;
+    double end_offset_sec;
+    float peak;
+    float mean;
+    bool adaptive = false; // Detected against the candidate's baseline rather than fixed thresholds
+    double peak_z = 0;     // Peak in baseline standard deviations, once the baseline is calibrated
+};
+
+// Per-candidate resting level of one signal, updated in O(1) per sample without storing
+// history. The first CALIBRATION_SAMPLES are averaged exactly (Welford); after that mean and
+// variance are exponentially weighted so the baseline follows slow drift. The standard
+// deviation is floored at `min_stddev` so a very steady candidate is not flagged for noise.
+struct Baseline {
+    static constexpr size_t CALIBRATION_SAMPLES = 300; // About 10 s of readings
+    static constexpr double ALPHA = 0.002;             // EWMA weight, a memory of roughly 500 samples
+
+    double min_stddev;
+    size_t samples = 0;
+    double mean = 0;
+    double m2 = 0; // Welford sum of squared deviations, during calibration
+    double variance = 0;
+
+    explicit Baseline(double min_sd) : min_stddev(min_sd) {}
+
+    void Update(double x) {
+        samples++;
+        double delta = x - mean;
+        if (samples <= CALIBRATION_SAMPLES) {
+            mean += delta / samples;
+            m2 += delta * (x - mean);
+            variance = samples > 1 ? m2 / (samples - 1) : 0;
+        } else {
+            mean += ALPHA * delta;
+            variance = (1 - ALPHA) * (variance + ALPHA * delta * delta);
+        }
+    }
+
+    bool Ready() const { return samples >= CALIBRATION_SAMPLES; }
+
+    double StdDev() const { return std::max(min_stddev, std::sqrt(variance)); }
+
+    // Value `z` standard deviations above the mean
+    float Level(double z) const { return (float)(mean + z * StdDev()); }
+
+    double ZScore(double x) const { return (x - mean) / StdDev(); }
+
+    BaselineSummary Summary() const { return {mean, StdDev(), samples, Ready()}; }
+};
+
+// When a signal counts as stressed. An episode starts once the value rises above `onset`
+// and ends once it has stayed below `offset` for `merge_gap_sec`, so brief dips do not split
+// it. Episodes shorter than `min_duration_sec` are treated as noise.
+struct EpisodeThresholds {
+    float onset;
+    float offset;
+    double min_duration_sec = 3.0;
+    double merge_gap_sec = 2.0;
+    bool adaptive = false; // onset/offset come from the candidate's baseline
+};
+
+// Streaming stress episode detector for one signal, O(1) state and work per sample.
+// The episode ends at the last sample above `offset`; samples in a dip that is bridged
+// count towards the mean.
+struct EpisodeDetector {
+    std::string type;
+    EpisodeThresholds thresholds;
+
+    bool active = false;
+    bool adaptive = false; // Thresholds in force when the episode started
+    double start_sec = 0;
+    double last_above_sec = 0;
+    float peak = 0;
+    double sum = 0;
+    size_t count = 0;
+    double dip_sum = 0;  // Samples below `offset` since last_above_sec
+    size_t dip_count = 0;
+
+    EpisodeDetector(std::string t, const EpisodeThresholds& th) : type(std::move(t)), thresholds(th) {}
+
+    // Feeds one sample. Returns true if an episode ended and was written to `episode`.
+    bool Update(int question, double t, float value, StressEvent& episode) {
+        if (!active) {
+            if (value <= thresholds.onset) return false;
+            active = true;
+            adaptive = thresholds.adaptive;
+            start_sec = last_above_sec = t;
+            peak = value;
+            sum = value;
+            count = 1;
+            dip_sum = 0;
+            dip_count = 0;
+            return false;
+        }
+
+        if (value >= thresholds.offset) {
+            sum += dip_sum + value; // The dip was bridged
+            count += dip_count + 1;
+            dip_sum = 0;
+            dip_count = 0;
+            peak = std::max(peak, value);
+            last_above_sec = t;
+            return false;
+        }
+
+        dip_sum += value;
+        dip_count++;
+        if (t - last_above_sec < thresholds.merge_gap_sec) return false;
+        return Close(question, episode);
+    }
+
+    // Ends an open episode, e.g. when the question ends. Returns true if it was long enough
+    // to report.
+    bool Close(int question, StressEvent& episode) {
+        if (!active) return false;
+        active = false;
+        if (last_above_sec - start_sec < thresholds.min_duration_sec) return false;
+
+        episode = {question, start_sec, type, peak, start_sec, last_above_sec, peak, (float)(sum / count), adaptive};
+        return true;
+    }
+
+    void Reset() { active = false; }
+};
+
+// Stress on one signal, judged against the candidate's own baseline: an episode starts
+// ONSET_Z standard deviations above it and ends below OFFSET_Z. Until the baseline is
+// calibrated the detector keeps its fixed thresholds.
+struct StressMonitor {
+    static constexpr double ONSET_Z = 3.0;
+    static constexpr double OFFSET_Z = 2.0;
+
+    EpisodeDetector detector;
+    Baseline baseline;
+
+    StressMonitor(std::string type, const EpisodeThresholds& absolute, double min_stddev)
+        : detector(std::move(type), absolute), baseline(min_stddev) {}
+
+    // Runs one sample through the detector, then folds it into the baseline. Returns true if
+    // an episode ended and was written to `episode`. Samples that are not readings are
+    // skipped; a run of zeros would otherwise drag the mean down and inflate the spread.
+    // Once calibrated, samples inside an episode are left out so they do not drag the
+    // baseline towards the stressed level; during calibration every sample counts, since a
+    // candidate resting above the fixed thresholds would otherwise never get a baseline.
+    bool Update(int question, double t, float value, StressEvent& episode) {
+        if (!IsValidRate(value)) return false;
+
+        if (baseline.Ready()) {
+            detector.thresholds.onset = baseline.Level(ONSET_Z);
+            detector.thresholds.offset = baseline.Level(OFFSET_Z);
+            detector.thresholds.adaptive = true;
+        }
+
+        bool ended = detector.Update(question, t, value, episode);
+        if (ended) Annotate(episode);
+        if (!baseline.Ready() || !detector.active) baseline.Update(value);
+        return ended;
+    }
+
+    // Ends an open episode, e.g. when the question ends. Returns true if it was reported.
+    bool Close(int question, StressEvent& episode) {
+        if (!detector.Close(question, episode)) return false;
+        Annotate(episode);
+        return true;
+    }
+
+    void Reset() { detector.Reset(); }
+
+    void Annotate(StressEvent& episode) const {
+        episode.peak_z = baseline.Ready() ? baseline.ZScore(episode.peak) : 0;
+    }
+};
+}  // namespace vitals
@@ -0,0 +1,143 @@
+// publish_alloc_test.cpp
+// Publishing a pooled frame must not touch the heap once the stream is warmed up, in either
+// delivery mode. Every operator new in the process is counted, the streamer's own threads
+// included, while frames are published to one viewer that keeps up and one that never reads.
+// The streamer takes a free port, so the test can run alongside others.
+
+#include <nadjieb/mjpeg_streamer.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+static std::atomic<long> g_allocations{0};
+
+// Out of line, so GCC does not pair the inlined malloc/free with new/delete and warn
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int WARMUP_FRAMES = 60;
+constexpr int MAX_WARMUP_FRAMES = 2000;
+constexpr int MEASURED_FRAMES = 300;
+constexpr size_t FRAME_BYTES = 32 * 1024;
+
+// `receive_buffer` shrinks the socket's receive buffer (0 keeps the default)
+int Connect(int port, const char* path, int receive_buffer = 0) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (receive_buffer > 0) ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd == -1 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "FAIL: cannot connect to port " << port << "\n";
+        std::exit(1);
+    }
+
+    char req[128];
+    int len = std::snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    if (::send(fd, req, (size_t)len, 0) != len) {
+        std::cerr << "FAIL: cannot send request\n";
+        std::exit(1);
+    }
+    return fd;
+}
+
+void Publish(nadjieb::MJPEGStreamer& streamer, const nadjieb::net::TopicHandle& topic,
+             nadjieb::net::FramePool& pool, int i) {
+    auto frame = pool.acquire();
+    frame->getBuffer().assign(FRAME_BYTES, (unsigned char)('a' + i % 26));
+    frame->seal();
+    streamer.publish(topic, std::move(frame));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+// One warmed-up measurement in `mode`. Returns false if publishing allocated.
+bool RunPass(nadjieb::net::DeliveryMode mode, const char* name) {
+    nadjieb::MJPEGStreamer streamer;
+    streamer.setDeliveryMode(mode);
+    auto topic = streamer.registerTopic("/video_feed");
+    streamer.start(0);
+    int port = streamer.getPort();
+
+    // Reads into a fixed buffer, so the reader itself never allocates
+    int fast = Connect(port, "/video_feed");
+    std::atomic<bool> reading{true};
+    std::atomic<size_t> received{0};
+    std::thread reader([&] {
+        static char buffer[64 * 1024];
+        while (reading) {
+            ssize_t n = ::recv(fast, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            received += (size_t)n;
+        }
+    });
+
+    // Never reads: its socket fills and it stays parked waiting for writability
+    int stalled = Connect(port, "/video_feed", 4096);
+
+    // Warm up until the stalled viewer is parked, so its first block is not measured
+    nadjieb::net::FramePool pool(8, FRAME_BYTES);
+    pool.prefill();
+    int warmup = 0;
+    while (warmup < WARMUP_FRAMES || streamer.getStats().clients_waiting == 0) {
+        if (warmup == MAX_WARMUP_FRAMES) {
+            std::cerr << "FAIL: " << name << ": the stalled viewer never blocked\n";
+            std::exit(1);
+        }
+        Publish(streamer, topic, pool, warmup++);
+    }
+
+    size_t received_before = received;
+    long before = g_allocations.load();
+    for (int i = 0; i < MEASURED_FRAMES; ++i) Publish(streamer, topic, pool, i);
+    long allocations = g_allocations.load() - before;
+    size_t delivered = received - received_before;
+
+    reading = false;
+    ::shutdown(fast, SHUT_RDWR);
+    reader.join();
+    ::close(fast);
+    ::close(stalled);
+    streamer.stop();
+
+    std::cout << name << ": " << MEASURED_FRAMES << " frames published, " << delivered << " bytes delivered, "
+              << allocations << " heap allocations\n";
+    if (delivered < FRAME_BYTES) {
+        std::cerr << "FAIL: " << name << ": the viewer received no frames, nothing was measured\n";
+        std::exit(1);
+    }
+    if (allocations != 0) {
+        std::cerr << "FAIL: " << name << ": publishing allocated in steady state\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool ok = RunPass(nadjieb::net::DeliveryMode::LATEST, "LATEST");
+    ok = RunPass(nadjieb::net::DeliveryMode::QUEUE, "QUEUE") && ok;
+    if (!ok) return 1;
+    std::cout << "PASS\n";
+    return 0;
+}
@@ -0,0 +1,189 @@
+// stress_detection_test.cpp
+// EpisodeDetector's hysteresis, merge gap, minimum duration and end-of-question close, and
+// StressMonitor's handling of dropouts. The SDK reports a rate of 0 whenever it loses the
+// signal. Those samples must not reach the baseline or the episode detector: a steady 72 BPM
+// candidate with dropouts has to calibrate to about 72, and a dropout inside an episode must
+// neither end nor dilute it.
+
+#include <vitals/stress_detection.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr double SAMPLE_RATE = 30.0; // Samples per second, as the SDK delivers them
+
+int g_failures = 0;
+
+void Check(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        g_failures++;
+    }
+}
+
+// 72 +/- 2 BPM, with every tenth sample a dropout
+float RestingPulse(int i) { return (i % 10 == 9) ? 0.0f : (float)(72.0 + 2.0 * std::sin(i * 0.7)); }
+
+vitals::StressMonitor PulseMonitor() { return vitals::StressMonitor("Pulse", {100.0f, 95.0f}, 3.0); }
+
+// Feeds `count` samples from `value` starting at sample `first`, collecting ended episodes
+template <typename F>
+void Feed(vitals::StressMonitor& monitor, int first, int count, F value, std::vector<vitals::StressEvent>& episodes) {
+    for (int i = first; i < first + count; ++i) {
+        vitals::StressEvent episode;
+        if (monitor.Update(1, i / SAMPLE_RATE, value(i), episode)) episodes.push_back(episode);
+    }
+}
+
+// Pulse thresholds as SessionManager starts with: onset 100, offset 95, 3 s minimum, 2 s gap
+vitals::EpisodeDetector PulseDetector() { return vitals::EpisodeDetector("Pulse", {100.0f, 95.0f}); }
+
+// Feeds `seconds` of a constant `value` from sample `first`, returns the next sample index
+int Hold(vitals::EpisodeDetector& detector, int first, double seconds, float value,
+         std::vector<vitals::StressEvent>& episodes) {
+    int last = first + (int)std::lround(seconds * SAMPLE_RATE);
+    for (int i = first; i < last; ++i) {
+        vitals::StressEvent episode;
+        if (detector.Update(1, i / SAMPLE_RATE, value, episode)) episodes.push_back(episode);
+    }
+    return last;
+}
+
+void TestHysteresis() {
+    auto detector = PulseDetector();
+    std::vector<vitals::StressEvent> episodes;
+    int i = Hold(detector, 0, 5, 99.0f, episodes); // Between offset and onset: no episode yet
+    Check(!detector.active, "no episode below onset");
+
+    int start = i;
+    i = Hold(detector, i, 1, 101.0f, episodes);
+    i = Hold(detector, i, 4, 97.0f, episodes); // Below onset, above offset: the episode goes on
+    Check(detector.active, "episode continues above offset");
+    int last_above = i - 1;
+    Hold(detector, i, 3, 90.0f, episodes);
+
+    Check(episodes.size() == 1, "one episode once below offset past the merge gap");
+    if (episodes.size() != 1) return;
+    const auto& e = episodes[0];
+    Check(e.type == "Pulse" && e.question_number == 1 && !e.adaptive, "episode fields");
+    Check(std::fabs(e.start_offset_sec - start / SAMPLE_RATE) < 1e-9, "episode starts at the onset crossing");
+    Check(std::fabs(e.end_offset_sec - last_above / SAMPLE_RATE) < 1e-9, "episode ends at the last sample above offset");
+    Check(e.peak == 101.0f, "peak");
+    Check(std::fabs(e.mean - (101.0f * 30 + 97.0f * 120) / 150) < 1e-3, "mean of the samples above offset");
+}
+
+void TestShortDipIsBridged() {
+    auto detector = PulseDetector();
+    std::vector<vitals::StressEvent> episodes;
+    int i = Hold(detector, 0, 2, 105.0f, episodes);
+    i = Hold(detector, i, 1, 90.0f, episodes); // Shorter than the 2 s merge gap
+    i = Hold(detector, i, 2, 110.0f, episodes);
+    Check(detector.active && episodes.empty(), "a short dip does not end the episode");
+    Hold(detector, i, 3, 80.0f, episodes);
+
+    Check(episodes.size() == 1, "one episode across the dip");
+    if (episodes.size() != 1) return;
+    const auto& e = episodes[0];
+    Check(std::fabs(e.start_offset_sec) < 1e-9 && std::fabs(e.end_offset_sec - 149 / SAMPLE_RATE) < 1e-9,
+          "episode spans both sides of the dip");
+    Check(e.peak == 110.0f, "peak after the dip");
+    Check(std::fabs(e.mean - (105.0f * 60 + 90.0f * 30 + 110.0f * 60) / 150) < 1e-3, "dip samples count in the mean");
+}
+
+void TestShortEpisodeIsSuppressed() {
+    auto detector = PulseDetector();
+    std::vector<vitals::StressEvent> episodes;
+    int i = Hold(detector, 0, 2, 105.0f, episodes); // Shorter than the 3 s minimum
+    i = Hold(detector, i, 3, 80.0f, episodes);
+    Check(episodes.empty() && !detector.active, "an episode under min_duration_sec is not reported");
+
+    // The detector is ready for the next one
+    i = Hold(detector, i, 4, 105.0f, episodes);
+    Hold(detector, i, 3, 80.0f, episodes);
+    Check(episodes.size() == 1, "a long enough episode after a suppressed one is reported");
+}
+
+void TestCloseAtEndOfQuestion() {
+    auto detector = PulseDetector();
+    std::vector<vitals::StressEvent> episodes;
+    int i = Hold(detector, 0, 4, 105.0f, episodes);
+    Hold(detector, i, 1, 90.0f, episodes); // Question ends inside a dip
+    Check(episodes.empty() && detector.active, "episode still open at the end of the question");
+
+    vitals::StressEvent episode;
+    Check(detector.Close(2, episode), "Close reports the open episode");
+    Check(episode.question_number == 2, "Close uses the question it is given");
+    Check(std::fabs(episode.end_offset_sec - (i - 1) / SAMPLE_RATE) < 1e-9, "Close ends at the last sample above offset");
+    Check(std::fabs(episode.mean - 105.0f) < 1e-3, "an unbridged dip is left out of the mean");
+    Check(!detector.Close(2, episode), "Close with no open episode reports nothing");
+
+    auto brief = PulseDetector();
+    Hold(brief, 0, 1, 105.0f, episodes);
+    Check(!brief.Close(1, episode) && !brief.active, "Close drops an episode under min_duration_sec");
+}
+
+void TestBaselineIgnoresDropouts() {
+    auto monitor = PulseMonitor();
+    std::vector<vitals::StressEvent> episodes;
+    Feed(monitor, 0, 600, RestingPulse, episodes);
+
+    const auto& baseline = monitor.baseline;
+    std::cout << "baseline: mean " << baseline.mean << ", stddev " << baseline.StdDev() << ", " << baseline.samples
+              << " samples, onset " << baseline.Level(vitals::StressMonitor::ONSET_Z) << "\n";
+    Check(baseline.Ready(), "baseline calibrated");
+    Check(baseline.samples == 540, "dropouts are not counted as samples");
+    Check(std::fabs(baseline.mean - 72.0) < 0.5, "baseline mean stays at the resting pulse");
+    Check(baseline.StdDev() < 3.5, "dropouts do not inflate the baseline spread");
+    Check(baseline.Level(vitals::StressMonitor::ONSET_Z) < 85.0f, "onset threshold stays near the resting pulse");
+    Check(episodes.empty(), "a resting candidate has no episodes");
+}
+
+void TestDropoutsInsideEpisode() {
+    auto monitor = PulseMonitor();
+    std::vector<vitals::StressEvent> episodes;
+    Feed(monitor, 0, 600, RestingPulse, episodes);
+
+    // 12 s at 110 BPM with a 3 s dropout in the middle, longer than the merge gap
+    Feed(monitor, 600, 360, [](int i) { return (i >= 750 && i < 840) ? 0.0f : 110.0f; }, episodes);
+    Check(monitor.detector.active, "a dropout does not end the episode");
+    Feed(monitor, 960, 300, RestingPulse, episodes);
+
+    Check(episodes.size() == 1, "one episode across the dropout");
+    if (episodes.size() != 1) return;
+    const auto& e = episodes[0];
+    std::cout << "episode: " << e.start_offset_sec << "-" << e.end_offset_sec << " s, mean " << e.mean << ", peak z "
+              << e.peak_z << "\n";
+    Check(e.adaptive, "detected against the baseline");
+    Check(std::fabs(e.start_offset_sec - 20.0) < 0.1 && std::fabs(e.end_offset_sec - 959 / SAMPLE_RATE) < 0.1,
+          "episode spans the whole rise");
+    Check(e.mean > 109.0f, "dropouts are not averaged into the episode");
+    Check(e.peak_z > 3.0, "peak is scored against the baseline");
+}
+
+void TestDropoutsAlone() {
+    auto monitor = PulseMonitor();
+    std::vector<vitals::StressEvent> episodes;
+    Feed(monitor, 0, 300, [](int i) { return (i % 2) ? 0.0f : 0.5f; }, episodes);
+    Check(monitor.baseline.samples == 0, "no readings, no baseline");
+    Check(!monitor.detector.active && episodes.empty(), "no readings, no episode");
+}
+
+} // namespace
+
+int main() {
+    TestHysteresis();
+    TestShortDipIsBridged();
+    TestShortEpisodeIsSuppressed();
+    TestCloseAtEndOfQuestion();
+    TestBaselineIgnoresDropouts();
+    TestDropoutsInsideEpisode();
+    TestDropoutsAlone();
+
+    if (g_failures) return 1;
+    std::cout << "PASS\n";
+    return 0;
+}
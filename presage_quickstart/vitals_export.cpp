@@ -0,0 +1,97 @@
+// vitals_export.cpp
+// Converts a binary raw_vitals_log.bin (RAW_VITALS_FORMAT=binary) to the raw_vitals_log.csv
+// layout, optionally limited to a timestamp range.
+
+#include <vitals/raw_vitals_format.hpp>
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Parses a whole decimal timestamp. Returns false for anything else, including a value out
+// of range, so a typo is never silently read as 0.
+static bool ParseTimestamp(const char* str, int64_t& value) {
+    const char* end = str + std::strlen(str);
+    auto res = std::from_chars(str, end, value);
+    return res.ec == std::errc() && res.ptr == end;
+}
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc && !usage_error; ++i) {
+        bool is_from = std::strcmp(argv[i], "--from") == 0;
+        if (is_from || std::strcmp(argv[i], "--to") == 0) {
+            if (i + 1 == argc || !ParseTimestamp(argv[i + 1], is_from ? from : to)) {
+                std::cerr << "Error: " << argv[i] << " needs an SDK timestamp"
+                          << (i + 1 < argc ? std::string(", not '") + argv[i + 1] + "'" : std::string()) << "\n";
+                usage_error = true;
+            }
+            ++i;
+        } else if (!input) {
+            input = argv[i];
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            usage_error = true;
+        }
+    }
+
+    if (!input || usage_error) {
+        std::cerr << "Usage: ./vitals_export raw_vitals_log.bin [output.csv] [--from TIMESTAMP] [--to TIMESTAMP]\n"
+                  << "Writes CSV to stdout when no output file is given. The range is inclusive.\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    vitals::RawVitalsFileReader reader;
+    if (!reader.Open(input)) {
+        std::cerr << "Error: " << input << ": " << reader.error << "\n";
+        return 1;
+    }
+
+    // Records are in time order, so the range is found by binary search
+    uint64_t first = reader.LowerBound(from);
+    uint64_t last = (to == INT64_MAX) ? reader.Size() : reader.LowerBound(to + 1);
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    FILE* out = output ? std::fopen(output, "w") : stdout;
+    if (!out) {
+        std::cerr << "Error: cannot write " << output << "\n";
+        return 1;
+    }
+
+    std::string buffer(vitals::RAW_VITALS_CSV_HEADER);
+    buffer.reserve(1 << 20);
+    char line[vitals::RAW_VITALS_CSV_ROW_MAX];
+    for (uint64_t i = first; i < last; ++i) {
+        char* end = vitals::FormatCsvRow(reader.At(i), line);
+        buffer.append(line, end - line);
+        if (buffer.size() >= (1 << 20) - vitals::RAW_VITALS_CSV_ROW_MAX) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+
+    bool write_failed = std::ferror(out) != 0;
+    if (output) write_failed |= std::fclose(out) != 0;
+    if (write_failed) {
+        std::cerr << "Error: writing CSV failed\n";
+        return 1;
+    }
+
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "[INFO] " << (last - first) << " of " << reader.Size() << " records exported (opened in " << load_ms
+              << " ms, " << total_ms << " ms total)\n";
+    return 0;
+}
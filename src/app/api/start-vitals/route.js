@@ -1,23 +1,43 @@
 import { promises as fs } from 'fs';
 import path from 'path';
 
+const CONTROL_URL = 'http://localhost:8080/control';
+
+// The engine only accepts commands carrying its control token: VITALS_CONTROL_TOKEN when both
+// sides set it, or else the one it generates into control_token at startup (re-read on every
+// request, so an engine restart is picked up)
+async function controlToken() {
+    if (process.env.VITALS_CONTROL_TOKEN) return process.env.VITALS_CONTROL_TOKEN;
+    const tokenPath = path.join(process.cwd(), 'presage_quickstart', 'control_token');
+    return (await fs.readFile(tokenPath, 'utf8').catch(() => '')).trim();
+}
+
 export async function POST(request) {
     try {
         const body = await request.json().catch(() => ({}));
         const action = body.action || 'START'; // Default to START
 
-        // Define the path to the trigger file
-        // Assumes the Next.js app is in the root and presage_quickstart is a subdirectory
-        const triggerFilePath = path.join(process.cwd(), 'presage_quickstart', 'vitals_trigger.tmp');
+        // Forward the command to the vitals engine's control endpoint
+        const res = await fetch(CONTROL_URL, {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json', 'X-Control-Token': await controlToken() },
+            body: JSON.stringify({ action }),
+            cache: 'no-store'
+        });
+        const ack = await res.json().catch(() => ({}));
 
-        // Write the action to the file
-        await fs.writeFile(triggerFilePath, action, 'utf8');
+        if (!res.ok) {
+            console.error(`Vitals engine rejected action ${action}:`, ack);
+            return Response.json({ error: ack.error || 'Vitals engine rejected the command' }, { status: res.status });
+        }
 
-        console.log(`Trigger file created at: ${triggerFilePath} with action: ${action}`);
+        // The engine queues the command and applies it in order; the ack carries the question
+        // the command leaves the session on
+        console.log(`Vitals command queued: ${action} (Q${ack.question_number}, recording: ${ack.recording})`);
 
-        return Response.json({ message: `Vitals trigger sent: ${action}` }, { status: 200 });
+        return Response.json({ message: `Vitals trigger sent: ${action}`, ...ack }, { status: 200 });
     } catch (error) {
-        console.error('Error creating trigger file:', error);
-        return Response.json({ error: 'Failed to trigger vitals tracking' }, { status: 500 });
+        console.error('Error sending vitals command:', error);
+        return Response.json({ error: 'Failed to trigger vitals tracking' }, { status: 502 });
     }
 }
@@ -55,19 +55,65 @@ export default function InterviewPage() {
     setSessionId(Date.now().toString());
     setStatusText("Click Start to begin.");
 
-    // Vitals Polling
-    const interval = setInterval(async () => {
-      try {
-        const res = await fetch('/api/vitals', { cache: 'no-store' });
-        if (res.ok) {
-          const vData = await res.json();
-          setVitals(vData);
+    // Vitals: pushed by the engine over Server-Sent Events. While the stream is down (e.g. the
+    // engine restarting) the page polls, and reconnects with backoff until the stream is back.
+    let interval = null;
+    const startPolling = () => {
+      if (interval) return;
+      interval = setInterval(async () => {
+        try {
+          const res = await fetch('/api/vitals', { cache: 'no-store' });
+          if (res.ok) {
+            const vData = await res.json();
+            setVitals(vData);
+          }
+        } catch (err) { }
+      }, 500);
+    };
+    const stopPolling = () => {
+      if (interval) clearInterval(interval);
+      interval = null;
+    };
+
+    let vitalsSource = null;
+    let reconnectTimer = null;
+    let reconnectDelay = 1000;
+    let unmounted = false;
+    const connectVitals = () => {
+      reconnectTimer = null;
+      if (unmounted) return;
+      vitalsSource = new EventSource('http://localhost:8080/vitals');
+      vitalsSource.onopen = () => {
+        reconnectDelay = 1000;
+        stopPolling();
+      };
+      vitalsSource.onmessage = (event) => {
+        try {
+          setVitals(JSON.parse(event.data));
+        } catch (err) { }
+      };
+      vitalsSource.onerror = () => {
+        // Retry on our own schedule rather than the browser's, polling in the meantime
+        vitalsSource.close();
+        vitalsSource = null;
+        startPolling();
+        if (!unmounted && !reconnectTimer) {
+          reconnectTimer = setTimeout(connectVitals, reconnectDelay);
+          reconnectDelay = Math.min(reconnectDelay * 2, 30000);
         }
-      } catch (err) { }
-    }, 500);
+      };
+    };
+    if (typeof EventSource !== 'undefined') {
+      connectVitals();
+    } else {
+      startPolling();
+    }
 
     return () => {
-      clearInterval(interval);
+      unmounted = true;
+      if (reconnectTimer) clearTimeout(reconnectTimer);
+      if (vitalsSource) vitalsSource.close();
+      stopPolling();
       stopAudioRecording();
       if (audioInstanceRef.current) {
         audioInstanceRef.current.pause();
@@ -168,13 +214,14 @@ export default function InterviewPage() {
   // --- Vitals Start (HEAD) ---
   const startVitalsSession = async (action = 'START') => {
     try {
-      await fetch('/api/start-vitals', {
+      const res = await fetch('/api/start-vitals', {
         method: 'POST',
         headers: { 'Content-Type': 'application/json' },
         body: JSON.stringify({ action })
       });
+      const ack = await res.json().catch(() => ({}));
       setIsSessionActive(true);
-      console.log(`Vitals Session Triggered: ${action}`);
+      console.log(`Vitals Session Triggered: ${action} (Q${ack.question_number})`);
     } catch (error) {
       console.error('Error starting vitals session:', error);
     }